@@ -0,0 +1,483 @@
+#ifndef ARCHETYPE_STORAGE_HPP
+#define ARCHETYPE_STORAGE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Entities of one archetype stored column-wise: every component of an entity sits at the same slot of its chunk's
+// per-component arrays. Like Block, chunks hand out slots from a free list, so entity handles stay valid until erased.
+// Handles name their chunk by index into a table and carry the generation stamped on their slot at insertion, so a
+// handle to an erased entity is reported as not alive even after its slot or its chunk's index has been reused.
+template< typename... Components >
+class ArchetypeStorage
+{
+	static_assert(sizeof...(Components) > 0, "Archetype must have at least one component");
+
+	template< typename C >
+	static constexpr size_t component_count = (size_t(std::is_same_v< C, Components >) + ...);
+
+	static_assert(((component_count< Components > == 1) && ...), "Component types must be distinct");
+
+	static constexpr size_t NO_SLOT = SIZE_MAX;
+
+	template< typename Self, typename C >
+	using column_t = std::conditional_t< std::is_const_v< Self >, const C, C >;
+
+	struct Chunk
+	{
+		std::tuple< Components *... > columns;
+		unsigned char *alive;
+		uint64_t *generations;
+		size_t *next_free;
+		size_t used_slots;
+		size_t live;
+		size_t free_head;
+		Chunk *prev_chunk;
+		Chunk *next_chunk;
+		Chunk *prev_available;
+		Chunk *next_available;
+		size_t index;
+		bool in_available;
+	};
+
+  public:
+	struct Entity
+	{
+		size_t chunk;
+		size_t slot;
+		uint64_t generation;
+
+		bool operator==(const Entity &other) const = default;
+	};
+
+	using size_type = std::size_t;
+
+	explicit ArchetypeStorage(size_t chunk_capacity = 64);
+
+	ArchetypeStorage(const ArchetypeStorage &other) = delete;
+
+	ArchetypeStorage(ArchetypeStorage &&other) noexcept;
+
+	~ArchetypeStorage();
+
+	ArchetypeStorage &operator=(const ArchetypeStorage &other) = delete;
+
+	ArchetypeStorage &operator=(ArchetypeStorage &&other) noexcept;
+
+	template< typename... Args >
+	Entity insert(Args &&...components);
+
+	void erase(Entity entity);
+
+	[[nodiscard]] bool contains(Entity entity) const noexcept;
+
+	template< typename C >
+	C &get(Entity entity);
+
+	template< typename C >
+	const C &get(Entity entity) const;
+
+	// Calls visitor(Query &...) for every live entity, streaming the Query columns of each chunk in lockstep.
+	template< typename... Query, typename Visitor >
+	void for_each(Visitor &&visitor);
+
+	template< typename... Query, typename Visitor >
+	void for_each(Visitor &&visitor) const;
+
+	[[nodiscard]] bool empty() const noexcept;
+
+	[[nodiscard]] size_type size() const noexcept;
+
+	[[nodiscard]] size_type capacity() const noexcept;
+
+	void clear() noexcept;
+
+	void swap(ArchetypeStorage &other) noexcept;
+
+  private:
+	Chunk *find_chunk(Entity entity) const noexcept;
+
+	Chunk *create_chunk();
+
+	void release_chunk(Chunk *chunk) noexcept;
+
+	void push_available(Chunk *chunk) noexcept;
+
+	void remove_available(Chunk *chunk) noexcept;
+
+	void destroy_slot(Chunk *chunk, size_t slot) noexcept;
+
+	template< size_t I, typename Arg, typename... Rest >
+	void construct_components(Chunk *chunk, size_t slot, Arg &&arg, Rest &&...rest);
+
+	template< typename Self, typename... Query, typename Visitor >
+	static void visit(Self &self, Visitor &visitor);
+
+	Chunk *head_chunk;
+	Chunk *tail_chunk;
+	Chunk *available_head;
+	std::vector< Chunk * > chunk_table;
+	std::vector< size_t > free_indices;
+	size_t chunk_capacity;
+	size_t chunks_count;
+	size_t entities_count;
+	uint64_t next_generation;
+};
+
+template< typename... Components >
+ArchetypeStorage< Components... >::ArchetypeStorage(size_t chunk_capacity) :
+	head_chunk(nullptr), tail_chunk(nullptr), available_head(nullptr), chunk_capacity(chunk_capacity),
+	chunks_count(0), entities_count(0), next_generation(1)
+{
+	if (chunk_capacity == 0)
+	{
+		throw std::invalid_argument("Chunk capacity must be greater than 0");
+	}
+}
+
+template< typename... Components >
+ArchetypeStorage< Components... >::ArchetypeStorage(ArchetypeStorage &&other) noexcept :
+	head_chunk(other.head_chunk), tail_chunk(other.tail_chunk), available_head(other.available_head),
+	chunk_table(std::move(other.chunk_table)), free_indices(std::move(other.free_indices)),
+	chunk_capacity(other.chunk_capacity), chunks_count(other.chunks_count), entities_count(other.entities_count),
+	next_generation(other.next_generation)
+{
+	other.head_chunk = other.tail_chunk = other.available_head = nullptr;
+	other.chunk_table.clear();
+	other.free_indices.clear();
+	other.chunks_count = 0;
+	other.entities_count = 0;
+}
+
+template< typename... Components >
+ArchetypeStorage< Components... >::~ArchetypeStorage()
+{
+	clear();
+}
+
+template< typename... Components >
+ArchetypeStorage< Components... > &ArchetypeStorage< Components... >::operator=(ArchetypeStorage &&other) noexcept
+{
+	if (this != &other)
+	{
+		ArchetypeStorage temp(std::move(other));
+		swap(temp);
+	}
+	return *this;
+}
+
+template< typename... Components >
+template< typename... Args >
+typename ArchetypeStorage< Components... >::Entity ArchetypeStorage< Components... >::insert(Args &&...components)
+{
+	static_assert(sizeof...(Args) == sizeof...(Components), "insert takes one value per component");
+	Chunk *chunk = available_head ? available_head : create_chunk();
+	size_t slot = chunk->free_head != NO_SLOT ? chunk->free_head : chunk->used_slots;
+	try
+	{
+		construct_components< 0 >(chunk, slot, std::forward< Args >(components)...);
+	} catch (...)
+	{
+		if (chunk->live == 0)
+			release_chunk(chunk);
+		throw;
+	}
+
+	if (slot == chunk->free_head)
+		chunk->free_head = chunk->next_free[slot];
+	else
+		++chunk->used_slots;
+	chunk->alive[slot] = 1;
+	chunk->generations[slot] = next_generation;
+	++chunk->live;
+	++entities_count;
+	if (chunk->live == chunk_capacity)
+		remove_available(chunk);
+	return Entity{ chunk->index, slot, next_generation++ };
+}
+
+template< typename... Components >
+void ArchetypeStorage< Components... >::erase(Entity entity)
+{
+	Chunk *chunk = find_chunk(entity);
+	if (!chunk)
+	{
+		throw std::invalid_argument("Entity is not alive");
+	}
+	destroy_slot(chunk, entity.slot);
+	chunk->alive[entity.slot] = 0;
+	chunk->generations[entity.slot] = 0;
+	chunk->next_free[entity.slot] = chunk->free_head;
+	chunk->free_head = entity.slot;
+	--chunk->live;
+	--entities_count;
+	if (chunk->live == 0)
+		release_chunk(chunk);
+	else if (!chunk->in_available)
+		push_available(chunk);
+}
+
+template< typename... Components >
+bool ArchetypeStorage< Components... >::contains(Entity entity) const noexcept
+{
+	return find_chunk(entity) != nullptr;
+}
+
+template< typename... Components >
+template< typename C >
+C &ArchetypeStorage< Components... >::get(Entity entity)
+{
+	static_assert(component_count< C > == 1, "Component is not part of this archetype");
+	Chunk *chunk = find_chunk(entity);
+	if (!chunk)
+	{
+		throw std::out_of_range("Entity is not alive");
+	}
+	return std::get< C * >(chunk->columns)[entity.slot];
+}
+
+template< typename... Components >
+template< typename C >
+const C &ArchetypeStorage< Components... >::get(Entity entity) const
+{
+	return const_cast< ArchetypeStorage * >(this)->template get< C >(entity);
+}
+
+template< typename... Components >
+template< typename... Query, typename Visitor >
+void ArchetypeStorage< Components... >::for_each(Visitor &&visitor)
+{
+	visit< ArchetypeStorage, Query... >(*this, visitor);
+}
+
+template< typename... Components >
+template< typename... Query, typename Visitor >
+void ArchetypeStorage< Components... >::for_each(Visitor &&visitor) const
+{
+	visit< const ArchetypeStorage, Query... >(*this, visitor);
+}
+
+template< typename... Components >
+template< typename Self, typename... Query, typename Visitor >
+void ArchetypeStorage< Components... >::visit(Self &self, Visitor &visitor)
+{
+	static_assert(sizeof...(Query) > 0, "Query at least one component");
+	static_assert(((component_count< Query > == 1) && ...), "Queried component is not part of this archetype");
+	for (Chunk *chunk = self.head_chunk; chunk; chunk = chunk->next_chunk)
+	{
+		std::tuple< column_t< Self, Query > *... > columns(
+			std::get< Query * >(chunk->columns)...);
+		size_t used = chunk->used_slots;
+		if (chunk->live == used)
+		{
+			for (size_t slot = 0; slot < used; ++slot)
+				visitor(std::get< column_t< Self, Query > * >(columns)[slot]...);
+		}
+		else
+		{
+			for (size_t slot = 0; slot < used; ++slot)
+			{
+				if (chunk->alive[slot])
+					visitor(std::get< column_t< Self, Query > * >(columns)[slot]...);
+			}
+		}
+	}
+}
+
+template< typename... Components >
+bool ArchetypeStorage< Components... >::empty() const noexcept
+{
+	return entities_count == 0;
+}
+
+template< typename... Components >
+typename ArchetypeStorage< Components... >::size_type ArchetypeStorage< Components... >::size() const noexcept
+{
+	return entities_count;
+}
+
+template< typename... Components >
+typename ArchetypeStorage< Components... >::size_type ArchetypeStorage< Components... >::capacity() const noexcept
+{
+	return chunks_count * chunk_capacity;
+}
+
+template< typename... Components >
+void ArchetypeStorage< Components... >::clear() noexcept
+{
+	while (head_chunk)
+	{
+		Chunk *chunk = head_chunk;
+		for (size_t slot = 0; slot < chunk->used_slots && chunk->live > 0; ++slot)
+		{
+			if (chunk->alive[slot])
+			{
+				destroy_slot(chunk, slot);
+				chunk->alive[slot] = 0;
+				--chunk->live;
+			}
+		}
+		release_chunk(chunk);
+	}
+	chunk_table.clear();
+	free_indices.clear();
+	entities_count = 0;
+}
+
+template< typename... Components >
+void ArchetypeStorage< Components... >::swap(ArchetypeStorage &other) noexcept
+{
+	std::swap(head_chunk, other.head_chunk);
+	std::swap(tail_chunk, other.tail_chunk);
+	std::swap(available_head, other.available_head);
+	chunk_table.swap(other.chunk_table);
+	free_indices.swap(other.free_indices);
+	std::swap(chunk_capacity, other.chunk_capacity);
+	std::swap(chunks_count, other.chunks_count);
+	std::swap(entities_count, other.entities_count);
+	std::swap(next_generation, other.next_generation);
+}
+
+template< typename... Components >
+typename ArchetypeStorage< Components... >::Chunk *
+	ArchetypeStorage< Components... >::find_chunk(Entity entity) const noexcept
+{
+	if (entity.chunk >= chunk_table.size())
+		return nullptr;
+	Chunk *chunk = chunk_table[entity.chunk];
+	if (!chunk || entity.slot >= chunk->used_slots || chunk->generations[entity.slot] != entity.generation)
+		return nullptr;
+	return chunk;
+}
+
+template< typename... Components >
+typename ArchetypeStorage< Components... >::Chunk *ArchetypeStorage< Components... >::create_chunk()
+{
+	if (free_indices.empty())
+	{
+		free_indices.reserve(chunk_table.size() + 1);
+		chunk_table.push_back(nullptr);
+		free_indices.push_back(chunk_table.size() - 1);
+	}
+	size_t index = free_indices.back();
+	auto *chunk =
+		new Chunk{ {}, nullptr, nullptr, nullptr, 0, 0, NO_SLOT, tail_chunk, nullptr, nullptr, nullptr, index, false };
+	try
+	{
+		std::apply([this]< typename... C >(C *&...column)
+				   { ((column = std::allocator< C >().allocate(chunk_capacity)), ...); },
+				   chunk->columns);
+		chunk->alive = new unsigned char[chunk_capacity]();
+		chunk->generations = new uint64_t[chunk_capacity]();
+		chunk->next_free = new size_t[chunk_capacity];
+	} catch (...)
+	{
+		std::apply([this]< typename... C >(C *...column)
+				   { ((column ? std::allocator< C >().deallocate(column, chunk_capacity) : void()), ...); },
+				   chunk->columns);
+		delete[] chunk->alive;
+		delete[] chunk->generations;
+		delete chunk;
+		throw;
+	}
+
+	free_indices.pop_back();
+	chunk_table[index] = chunk;
+
+	if (tail_chunk)
+		tail_chunk->next_chunk = chunk;
+	else
+		head_chunk = chunk;
+	tail_chunk = chunk;
+	++chunks_count;
+	push_available(chunk);
+	return chunk;
+}
+
+template< typename... Components >
+void ArchetypeStorage< Components... >::release_chunk(Chunk *chunk) noexcept
+{
+	if (chunk->in_available)
+		remove_available(chunk);
+	if (chunk->prev_chunk)
+		chunk->prev_chunk->next_chunk = chunk->next_chunk;
+	else
+		head_chunk = chunk->next_chunk;
+	if (chunk->next_chunk)
+		chunk->next_chunk->prev_chunk = chunk->prev_chunk;
+	else
+		tail_chunk = chunk->prev_chunk;
+
+	// free_indices has room for every table entry, so this push_back never allocates.
+	chunk_table[chunk->index] = nullptr;
+	free_indices.push_back(chunk->index);
+
+	std::apply([this]< typename... C >(C *...column)
+			   { (std::allocator< C >().deallocate(column, chunk_capacity), ...); },
+			   chunk->columns);
+	delete[] chunk->alive;
+	delete[] chunk->generations;
+	delete[] chunk->next_free;
+	delete chunk;
+	--chunks_count;
+}
+
+template< typename... Components >
+void ArchetypeStorage< Components... >::push_available(Chunk *chunk) noexcept
+{
+	chunk->prev_available = nullptr;
+	chunk->next_available = available_head;
+	if (available_head)
+		available_head->prev_available = chunk;
+	available_head = chunk;
+	chunk->in_available = true;
+}
+
+template< typename... Components >
+void ArchetypeStorage< Components... >::remove_available(Chunk *chunk) noexcept
+{
+	if (chunk->prev_available)
+		chunk->prev_available->next_available = chunk->next_available;
+	else
+		available_head = chunk->next_available;
+	if (chunk->next_available)
+		chunk->next_available->prev_available = chunk->prev_available;
+	chunk->prev_available = chunk->next_available = nullptr;
+	chunk->in_available = false;
+}
+
+template< typename... Components >
+void ArchetypeStorage< Components... >::destroy_slot(Chunk *chunk, size_t slot) noexcept
+{
+	if constexpr (!(std::is_trivially_destructible_v< Components > && ...))
+		(std::get< Components * >(chunk->columns)[slot].~Components(), ...);
+}
+
+template< typename... Components >
+template< size_t I, typename Arg, typename... Rest >
+void ArchetypeStorage< Components... >::construct_components(Chunk *chunk, size_t slot, Arg &&arg, Rest &&...rest)
+{
+	using C = std::tuple_element_t< I, std::tuple< Components... > >;
+	C *target = std::get< I >(chunk->columns) + slot;
+	::new (static_cast< void * >(target)) C(std::forward< Arg >(arg));
+	if constexpr (sizeof...(Rest) > 0)
+	{
+		try
+		{
+			construct_components< I + 1 >(chunk, slot, std::forward< Rest >(rest)...);
+		} catch (...)
+		{
+			target->~C();
+			throw;
+		}
+	}
+}
+
+#endif /* ARCHETYPE_STORAGE_HPP */
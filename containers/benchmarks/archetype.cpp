@@ -0,0 +1,105 @@
+// Two-component system update: ArchetypeStorage::for_each against one storage per component joined through ids.
+//
+// Build: g++ -std=c++20 -O2 -I.. archetype.cpp -o archetype
+// Usage: ./archetype [entities] [repetitions]
+
+#include "archetype_storage.hpp"
+#include "bucket_hash_map.hpp"
+#include "bucket_storage.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <vector>
+
+struct Position
+{
+	float x, y, z;
+};
+
+struct Velocity
+{
+	float dx, dy, dz;
+};
+
+struct Health
+{
+	int points;
+	int armor;
+};
+
+template< typename Operation >
+static double best_ns(size_t entities, size_t repetitions, Operation &&operation)
+{
+	double best = 0;
+	for (size_t r = 0; r < repetitions; ++r)
+	{
+		auto start = std::chrono::steady_clock::now();
+		operation();
+		auto stop = std::chrono::steady_clock::now();
+		double ns = std::chrono::duration< double, std::nano >(stop - start).count() / static_cast< double >(entities);
+		if (r == 0 || ns < best)
+			best = ns;
+	}
+	return best;
+}
+
+int main(int argc, char **argv)
+{
+	size_t n = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : size_t(1) << 20;
+	size_t repetitions = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 5;
+
+	std::vector< size_t > ids(n);
+	std::iota(ids.begin(), ids.end(), size_t(0));
+	std::shuffle(ids.begin(), ids.end(), std::mt19937_64(42));
+
+	BucketHashMap< size_t, Position > positions;
+	BucketStorage< std::pair< size_t, Velocity > > velocities;
+	BucketStorage< std::pair< size_t, Health > > healths;
+	ArchetypeStorage< Position, Velocity, Health > world(1024);
+	for (size_t id : ids)
+	{
+		float f = static_cast< float >(id);
+		positions.try_emplace(id, Position{ f, f, f });
+		velocities.insert({ id, Velocity{ 1, 2, 3 } });
+		healths.insert({ id, Health{ 100, 0 } });
+		world.insert(Position{ f, f, f }, Velocity{ 1, 2, 3 }, Health{ 100, 0 });
+	}
+
+	double joined = best_ns(n,
+							repetitions,
+							[&]()
+							{
+								for (auto &[id, velocity] : velocities)
+								{
+									Position &position = positions.find(id)->second;
+									position.x += velocity.dx;
+									position.y += velocity.dy;
+									position.z += velocity.dz;
+								}
+							});
+	double streamed = best_ns(n,
+							  repetitions,
+							  [&]()
+							  {
+								  world.for_each< Position, Velocity >(
+									  [](Position &position, const Velocity &velocity)
+									  {
+										  position.x += velocity.dx;
+										  position.y += velocity.dy;
+										  position.z += velocity.dz;
+									  });
+							  });
+
+	float checksum = 0;
+	for (auto &[id, position] : positions)
+		checksum += position.x;
+	world.for_each< Position >([&checksum](const Position &position) { checksum -= position.x; });
+	std::cout << "per-component storages joined by id: " << joined << " ns/entity\n"
+			  << "ArchetypeStorage::for_each< Position, Velocity >: " << streamed << " ns/entity\n"
+			  << "checksum: " << checksum << '\n';
+	return 0;
+}
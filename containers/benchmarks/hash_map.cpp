@@ -0,0 +1,87 @@
+// BucketHashMap against std::unordered_map: time and heap allocations per operation.
+//
+// Build: g++ -std=c++20 -O2 -I.. hash_map.cpp -o hash_map
+// Usage: ./hash_map [elements] [repetitions]
+
+#include "allocation_counter.hpp"
+#include "bucket_hash_map.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+struct Sample
+{
+	double ns;
+	size_t allocations;
+};
+
+template< typename Operation >
+static Sample measure(size_t operations, Operation &&operation)
+{
+	size_t allocations_before = heapAllocations.load(std::memory_order_relaxed);
+	auto start = std::chrono::steady_clock::now();
+	operation();
+	auto stop = std::chrono::steady_clock::now();
+	return { std::chrono::duration< double, std::nano >(stop - start).count() / static_cast< double >(operations),
+			 heapAllocations.load(std::memory_order_relaxed) - allocations_before };
+}
+
+template< typename Map >
+static void run(const char *name, const std::vector< size_t > &keys, size_t repetitions, size_t &checksum)
+{
+	Sample best[3] = {};
+	for (size_t r = 0; r < repetitions; ++r)
+	{
+		Map map;
+		Sample insert = measure(keys.size(),
+								[&]()
+								{
+									for (size_t key : keys)
+										map[key] = key;
+								});
+		Sample lookup = measure(keys.size(),
+								[&]()
+								{
+									for (size_t key : keys)
+										checksum += map.find(key)->second;
+								});
+		Sample erase = measure(keys.size(),
+							   [&]()
+							   {
+								   for (size_t key : keys)
+									   map.erase(key);
+							   });
+		Sample current[3] = { insert, lookup, erase };
+		for (size_t i = 0; i < 3; ++i)
+			if (r == 0 || current[i].ns < best[i].ns)
+				best[i] = current[i];
+	}
+
+	const char *operations[3] = { "insert", "lookup", "erase" };
+	for (size_t i = 0; i < 3; ++i)
+		std::cout << name << ' ' << operations[i] << ": " << best[i].ns << " ns/op, "
+				  << static_cast< double >(best[i].allocations) / static_cast< double >(keys.size())
+				  << " allocations/op\n";
+}
+
+int main(int argc, char **argv)
+{
+	size_t n = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : size_t(1) << 20;
+	size_t repetitions = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 3;
+
+	std::vector< size_t > keys(n);
+	std::iota(keys.begin(), keys.end(), size_t(0));
+	std::shuffle(keys.begin(), keys.end(), std::mt19937_64(42));
+
+	size_t checksum = 0;
+	run< std::unordered_map< size_t, size_t > >("std::unordered_map", keys, repetitions, checksum);
+	run< BucketHashMap< size_t, size_t > >("BucketHashMap", keys, repetitions, checksum);
+	std::cout << "checksum: " << checksum << '\n';
+	return 0;
+}
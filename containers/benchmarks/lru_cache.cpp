@@ -0,0 +1,120 @@
+// BucketLRU against a std::list + std::unordered_map LRU: hit rate, throughput and heap allocations.
+//
+// Build: g++ -std=c++20 -O2 -I.. lru_cache.cpp -o lru_cache
+// Usage: ./lru_cache [cache entries] [key space] [requests]
+//
+// Requests follow a Zipf-like distribution over the key space; every miss inserts the key, evicting the least
+// recently used entry once the cache is full.
+
+#include "allocation_counter.hpp"
+#include "bucket_lru.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <list>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+class ListLRU
+{
+  public:
+	explicit ListLRU(size_t capacity) : capacity(capacity), hit_count(0), miss_count(0) { index.reserve(capacity); }
+
+	size_t *get(size_t key)
+	{
+		auto found = index.find(key);
+		if (found == index.end())
+		{
+			++miss_count;
+			return nullptr;
+		}
+		++hit_count;
+		entries.splice(entries.begin(), entries, found->second);
+		return &found->second->second;
+	}
+
+	void put(size_t key, size_t value)
+	{
+		if (entries.size() == capacity)
+		{
+			index.erase(entries.back().first);
+			entries.pop_back();
+		}
+		entries.emplace_front(key, value);
+		index[key] = entries.begin();
+	}
+
+	size_t hits() const { return hit_count; }
+
+	size_t misses() const { return miss_count; }
+
+  private:
+	size_t capacity;
+	size_t hit_count;
+	size_t miss_count;
+	std::list< std::pair< size_t, size_t > > entries;
+	std::unordered_map< size_t, std::list< std::pair< size_t, size_t > >::iterator > index;
+};
+
+static std::vector< size_t > zipf_requests(size_t key_space, size_t count)
+{
+	std::vector< double > weights(key_space);
+	for (size_t i = 0; i < key_space; ++i)
+		weights[i] = 1.0 / std::pow(static_cast< double >(i + 1), 0.9);
+	std::discrete_distribution< size_t > distribution(weights.begin(), weights.end());
+	std::mt19937_64 generator(42);
+
+	std::vector< size_t > requests(count);
+	for (size_t &request : requests)
+		request = distribution(generator) * 0x9E3779B97F4A7C15ull;
+	return requests;
+}
+
+template< typename Cache >
+static void run(const char *name, size_t entries, const std::vector< size_t > &requests, size_t &checksum)
+{
+	Cache cache(entries);
+	for (size_t i = 0; i < requests.size() / 10; ++i)
+		if (!cache.get(requests[i]))
+			cache.put(requests[i], requests[i]);
+
+	size_t hits_before = cache.hits();
+	size_t misses_before = cache.misses();
+	size_t allocations_before = heapAllocations.load(std::memory_order_relaxed);
+	auto start = std::chrono::steady_clock::now();
+	for (size_t key : requests)
+	{
+		if (size_t *value = cache.get(key))
+			checksum += *value;
+		else
+			cache.put(key, key);
+	}
+	auto stop = std::chrono::steady_clock::now();
+
+	double ns =
+		std::chrono::duration< double, std::nano >(stop - start).count() / static_cast< double >(requests.size());
+	size_t hits = cache.hits() - hits_before;
+	size_t misses = cache.misses() - misses_before;
+	size_t allocations = heapAllocations.load(std::memory_order_relaxed) - allocations_before;
+	std::cout << name << ": hit rate " << static_cast< double >(hits) / static_cast< double >(hits + misses) << ", "
+			  << ns << " ns/request, "
+			  << static_cast< double >(allocations) / static_cast< double >(requests.size())
+			  << " allocations/request\n";
+}
+
+int main(int argc, char **argv)
+{
+	size_t entries = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : size_t(1) << 16;
+	size_t key_space = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : size_t(1) << 20;
+	size_t count = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : size_t(1) << 23;
+
+	std::vector< size_t > requests = zipf_requests(key_space, count);
+	size_t checksum = 0;
+	run< ListLRU >("std::list + std::unordered_map", entries, requests, checksum);
+	run< BucketLRU< size_t, size_t > >("BucketLRU", entries, requests, checksum);
+	std::cout << "checksum: " << checksum << '\n';
+	return 0;
+}
@@ -0,0 +1,161 @@
+#ifndef PERF_COUNTERS_HPP
+#define PERF_COUNTERS_HPP
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// User-space hardware counters read through perf_event_open. Counters the kernel or container refuses to open
+// stay unavailable and report no value instead of failing the run.
+class PerfCounters
+{
+  public:
+	enum Event
+	{
+		CYCLES,
+		INSTRUCTIONS,
+		L1D_MISSES,
+		LLC_MISSES,
+		DTLB_MISSES,
+		BRANCH_MISSES,
+		EVENT_COUNT
+	};
+
+	struct Sample
+	{
+		std::array< uint64_t, EVENT_COUNT > values;
+		std::array< bool, EVENT_COUNT > valid;
+	};
+
+	PerfCounters();
+
+	PerfCounters(const PerfCounters &other) = delete;
+
+	~PerfCounters();
+
+	PerfCounters &operator=(const PerfCounters &other) = delete;
+
+	[[nodiscard]] bool available(Event event) const noexcept;
+
+	[[nodiscard]] bool any_available() const noexcept;
+
+	void start() noexcept;
+
+	Sample stop() noexcept;
+
+	static const char *name(Event event) noexcept;
+
+  private:
+	std::array< int, EVENT_COUNT > descriptors;
+};
+
+inline PerfCounters::PerfCounters()
+{
+	descriptors.fill(-1);
+#ifdef __linux__
+	constexpr uint64_t read_miss = PERF_COUNT_HW_CACHE_OP_READ << 8 | PERF_COUNT_HW_CACHE_RESULT_MISS << 16;
+	const std::array< std::pair< uint32_t, uint64_t >, EVENT_COUNT > configs = { {
+		{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+		{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+		{ PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | read_miss },
+		{ PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_LL | read_miss },
+		{ PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_DTLB | read_miss },
+		{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+	} };
+	for (size_t i = 0; i < EVENT_COUNT; ++i)
+	{
+		perf_event_attr attr;
+		std::memset(&attr, 0, sizeof(attr));
+		attr.size = sizeof(attr);
+		attr.type = configs[i].first;
+		attr.config = configs[i].second;
+		attr.disabled = 1;
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+		attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+		descriptors[i] = static_cast< int >(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+	}
+#endif
+}
+
+inline PerfCounters::~PerfCounters()
+{
+#ifdef __linux__
+	for (int descriptor : descriptors)
+	{
+		if (descriptor >= 0)
+			close(descriptor);
+	}
+#endif
+}
+
+inline bool PerfCounters::available(Event event) const noexcept
+{
+	return descriptors[event] >= 0;
+}
+
+inline bool PerfCounters::any_available() const noexcept
+{
+	for (int descriptor : descriptors)
+	{
+		if (descriptor >= 0)
+			return true;
+	}
+	return false;
+}
+
+inline void PerfCounters::start() noexcept
+{
+#ifdef __linux__
+	for (int descriptor : descriptors)
+	{
+		if (descriptor >= 0)
+		{
+			ioctl(descriptor, PERF_EVENT_IOC_RESET, 0);
+			ioctl(descriptor, PERF_EVENT_IOC_ENABLE, 0);
+		}
+	}
+#endif
+}
+
+inline PerfCounters::Sample PerfCounters::stop() noexcept
+{
+	Sample sample = {};
+#ifdef __linux__
+	for (int descriptor : descriptors)
+	{
+		if (descriptor >= 0)
+			ioctl(descriptor, PERF_EVENT_IOC_DISABLE, 0);
+	}
+	for (size_t i = 0; i < EVENT_COUNT; ++i)
+	{
+		uint64_t data[3];
+		if (descriptors[i] < 0 || read(descriptors[i], data, sizeof(data)) != static_cast< ssize_t >(sizeof(data)) ||
+			data[2] == 0)
+			continue;
+		// Scale for multiplexing when more counters are open than the PMU can schedule at once.
+		sample.values[i] = data[2] == data[1]
+							   ? data[0]
+							   : static_cast< uint64_t >(static_cast< double >(data[0]) * data[1] / data[2]);
+		sample.valid[i] = true;
+	}
+#endif
+	return sample;
+}
+
+inline const char *PerfCounters::name(Event event) noexcept
+{
+	static const char *const names[EVENT_COUNT] = {
+		"cycles", "instructions", "L1d-miss", "LLC-miss", "dTLB-miss", "branch-miss"
+	};
+	return names[event];
+}
+
+#endif /* PERF_COUNTERS_HPP */
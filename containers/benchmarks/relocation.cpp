@@ -0,0 +1,76 @@
+// shrink_to_fit of 64-byte records with and without the trivially relocatable fast path. Each stretch of run + gap
+// inserted records keeps the first run and erases the rest, so the survivors form contiguous runs of slots that the
+// fast path can copy in one go.
+//
+// Build: g++ -std=c++20 -O2 -I.. relocation.cpp -o relocation
+// Usage: ./relocation [elements] [block capacity] [run] [gap]
+
+#include "bucket_storage.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+struct Record
+{
+	uint64_t fields[8];
+};
+
+struct SlowRecord : Record
+{
+};
+
+template<>
+struct is_trivially_relocatable< SlowRecord > : std::false_type
+{
+};
+
+template< typename R >
+static BucketStorage< R > make_holey_storage(size_t n, size_t block_capacity, size_t run, size_t gap)
+{
+	BucketStorage< R > storage(block_capacity);
+	std::vector< typename BucketStorage< R >::iterator > positions;
+	positions.reserve(n);
+	for (size_t i = 0; i < n; ++i)
+	{
+		R record{};
+		record.fields[0] = i;
+		positions.push_back(storage.insert(record));
+	}
+	for (size_t i = 0; i < n; ++i)
+	{
+		if (i % (run + gap) >= run)
+			storage.erase(positions[i]);
+	}
+	return storage;
+}
+
+template< typename R, typename Operation >
+static void measure(const char *name, size_t n, size_t block_capacity, size_t run, size_t gap, Operation &&operation,
+					uint64_t &checksum)
+{
+	BucketStorage< R > storage = make_holey_storage< R >(n, block_capacity, run, gap);
+	auto start = std::chrono::steady_clock::now();
+	operation(storage);
+	auto stop = std::chrono::steady_clock::now();
+	for (const R &record : storage)
+		checksum += record.fields[0];
+	std::cout << name << ": " << std::chrono::duration< double, std::milli >(stop - start).count() << " ms\n";
+}
+
+int main(int argc, char **argv)
+{
+	size_t n = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : size_t(1) << 21;
+	size_t block_capacity = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 64;
+	size_t run = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 48;
+	size_t gap = argc > 4 ? std::strtoull(argv[4], nullptr, 10) : 16;
+
+	uint64_t checksum = 0;
+	auto shrink = [](auto &storage) { storage.shrink_to_fit(); };
+	measure< SlowRecord >("shrink_to_fit, move + destroy", n, block_capacity, run, gap, shrink, checksum);
+	measure< Record >("shrink_to_fit, relocated", n, block_capacity, run, gap, shrink, checksum);
+	std::cout << "checksum: " << checksum << '\n';
+	return 0;
+}
@@ -0,0 +1,62 @@
+// BucketStorage::sort against copying into a std::vector, sorting it and reinserting the values.
+//
+// Build: g++ -std=c++20 -O2 -pthread -I.. sort.cpp -o sort
+// Usage: ./sort [elements] [threads]
+
+#include "bucket_storage.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <vector>
+
+static BucketStorage< uint64_t > make_storage(size_t n)
+{
+	BucketStorage< uint64_t > storage(64, 4096);
+	std::mt19937_64 generator(42);
+	for (size_t i = 0; i < n; ++i)
+		storage.insert(generator());
+	return storage;
+}
+
+template< typename Operation >
+static double measure_ms(Operation &&operation)
+{
+	auto start = std::chrono::steady_clock::now();
+	operation();
+	auto stop = std::chrono::steady_clock::now();
+	return std::chrono::duration< double, std::milli >(stop - start).count();
+}
+
+int main(int argc, char **argv)
+{
+	size_t n = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : size_t(1) << 22;
+	size_t threads = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 0;
+
+	BucketStorage< uint64_t > copied = make_storage(n);
+	double copy_ms = measure_ms(
+		[&copied]()
+		{
+			std::vector< uint64_t > values(copied.begin(), copied.end());
+			std::sort(values.begin(), values.end());
+			copied.clear();
+			for (uint64_t value : values)
+				copied.insert(value);
+		});
+
+	BucketStorage< uint64_t > in_place = make_storage(n);
+	double sort_ms = measure_ms([&in_place, threads]() { in_place.sort(std::less< uint64_t >(), false, threads); });
+
+	BucketStorage< uint64_t > stable = make_storage(n);
+	double stable_ms = measure_ms([&stable, threads]() { stable.sort(std::less< uint64_t >(), true, threads); });
+
+	bool same = std::equal(copied.begin(), copied.end(), in_place.begin(), in_place.end()) &&
+				std::equal(copied.begin(), copied.end(), stable.begin(), stable.end());
+	std::cout << "copy + std::sort + reinsert: " << copy_ms << " ms\n"
+			  << "BucketStorage::sort: " << sort_ms << " ms\n"
+			  << "BucketStorage::sort (stable): " << stable_ms << " ms\n"
+			  << "results match: " << (same ? "yes" : "no") << '\n';
+	return same ? 0 : 1;
+}
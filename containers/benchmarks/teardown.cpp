@@ -0,0 +1,44 @@
+// Cost of clear() and destruction for trivially and non-trivially destructible elements.
+//
+// Build: g++ -std=c++20 -O2 -I.. teardown.cpp -o teardown
+// Usage: ./teardown [elements] [block capacity]
+
+#include "bucket_storage.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+
+struct Trivial
+{
+	uint64_t value;
+};
+
+struct WithDestructor
+{
+	uint64_t value;
+	~WithDestructor() {}
+};
+
+template< typename R >
+static void run(const char *name, size_t n, size_t block_capacity)
+{
+	BucketStorage< R > storage(block_capacity, 1 << 16);
+	for (size_t i = 0; i < n; ++i)
+		storage.insert(R{ i });
+	auto start = std::chrono::steady_clock::now();
+	storage.clear();
+	auto stop = std::chrono::steady_clock::now();
+	std::cout << name << ": " << std::chrono::duration< double, std::milli >(stop - start).count() << " ms\n";
+}
+
+int main(int argc, char **argv)
+{
+	size_t n = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : size_t(1) << 24;
+	size_t block_capacity = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 64;
+
+	run< WithDestructor >("clear, user-provided destructor", n, block_capacity);
+	run< Trivial >("clear, trivially destructible", n, block_capacity);
+	return 0;
+}
@@ -0,0 +1,633 @@
+#ifndef BUCKET_HASH_MAP_HPP
+#define BUCKET_HASH_MAP_HPP
+
+#include "bucket_storage.hpp"
+
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+// Nodes live in a BucketStorage and never move, so pointers and references to entries stay valid across rehash.
+template< typename K, typename V, typename Hash = std::hash< K >, typename KeyEqual = std::equal_to< K > >
+class BucketHashMap
+{
+  public:
+	using key_type = K;
+	using mapped_type = V;
+	using value_type = std::pair< const K, V >;
+	using reference = value_type &;
+	using const_reference = const value_type &;
+	using size_type = std::size_t;
+	using difference_type = std::ptrdiff_t;
+	using hasher = Hash;
+	using key_equal = KeyEqual;
+
+  private:
+	struct Node
+	{
+		value_type entry;
+		size_t hash;
+		Node *next;
+		BucketStorageIterator< Node > position;
+
+		template< typename... Args >
+		explicit Node(size_t hash, Args &&...args);
+	};
+
+	template< bool IsConst >
+	class Iterator
+	{
+	  public:
+		using value_type = BucketHashMap::value_type;
+		using reference = std::conditional_t< IsConst, const value_type &, value_type & >;
+		using pointer = std::conditional_t< IsConst, const value_type *, value_type * >;
+		using difference_type = std::ptrdiff_t;
+		using iterator_category = std::forward_iterator_tag;
+
+		Iterator(Node *node, BucketStorage< Node > *nodes);
+
+		template< bool WasConst, typename = std::enable_if_t< IsConst && !WasConst > >
+		Iterator(const Iterator< WasConst > &other);
+
+		reference operator*() const;
+
+		pointer operator->() const;
+
+		Iterator &operator++();
+
+		Iterator operator++(int);
+
+		bool operator==(const Iterator &other) const;
+
+		bool operator!=(const Iterator &other) const;
+
+		// Null at end(); dereferencing goes straight to the node instead of through its storage iterator.
+		Node *node;
+		BucketStorage< Node > *nodes;
+	};
+
+  public:
+	using iterator = Iterator< false >;
+	using const_iterator = Iterator< true >;
+
+	BucketHashMap();
+
+	explicit BucketHashMap(size_t bucket_count);
+
+	BucketHashMap(const BucketHashMap &other);
+
+	BucketHashMap(BucketHashMap &&other) noexcept;
+
+	~BucketHashMap();
+
+	BucketHashMap &operator=(const BucketHashMap &other);
+
+	BucketHashMap &operator=(BucketHashMap &&other) noexcept;
+
+	std::pair< iterator, bool > insert(const value_type &value);
+
+	std::pair< iterator, bool > insert(value_type &&value);
+
+	template< typename... Args >
+	std::pair< iterator, bool > try_emplace(const key_type &key, Args &&...args);
+
+	template< typename... Args >
+	std::pair< iterator, bool > try_emplace(key_type &&key, Args &&...args);
+
+	mapped_type &operator[](const key_type &key);
+
+	mapped_type &operator[](key_type &&key);
+
+	mapped_type &at(const key_type &key);
+
+	const mapped_type &at(const key_type &key) const;
+
+	iterator find(const key_type &key);
+
+	const_iterator find(const key_type &key) const;
+
+	[[nodiscard]] bool contains(const key_type &key) const;
+
+	[[nodiscard]] size_type count(const key_type &key) const;
+
+	iterator erase(const_iterator it);
+
+	size_type erase(const key_type &key);
+
+	void clear();
+
+	void swap(BucketHashMap &other) noexcept;
+
+	void rehash(size_t bucket_count);
+
+	void reserve(size_t count);
+
+	[[nodiscard]] bool empty() const noexcept;
+
+	[[nodiscard]] size_type size() const noexcept;
+
+	[[nodiscard]] size_type bucket_count() const noexcept;
+
+	[[nodiscard]] float load_factor() const noexcept;
+
+	[[nodiscard]] float max_load_factor() const noexcept;
+
+	void max_load_factor(float factor);
+
+	iterator begin() noexcept;
+
+	iterator end() noexcept;
+
+	const_iterator begin() const noexcept;
+
+	const_iterator end() const noexcept;
+
+	const_iterator cbegin() const noexcept;
+
+	const_iterator cend() const noexcept;
+
+  private:
+	static constexpr size_t MIN_BUCKET_COUNT = 8;
+
+	size_t bucket_index(size_t hash) const noexcept;
+
+	iterator make_iterator(BucketStorageIterator< Node > position) noexcept;
+
+	Node *find_node(const key_type &key, size_t hash) const;
+
+	template< typename KeyArg, typename... Args >
+	std::pair< iterator, bool > emplace_unique(KeyArg &&key, Args &&...args);
+
+	void unlink_node(Node *node);
+
+	BucketStorage< Node > nodes;
+	Node **buckets;
+	size_t buckets_count;
+	unsigned bucket_shift;
+	float max_load;
+	Hash hash_function;
+	KeyEqual key_equal_function;
+};
+
+template< typename K, typename V, typename Hash, typename KeyEqual >
+template< typename... Args >
+BucketHashMap< K, V, Hash, KeyEqual >::Node::Node(size_t hash, Args &&...args) :
+	entry(std::forward< Args >(args)...), hash(hash), next(nullptr), position(nullptr, nullptr)
+{
+}
+
+template< typename K, typename V, typename Hash, typename KeyEqual >
+template< bool IsConst >
+BucketHashMap< K, V, Hash, KeyEqual >::Iterator< IsConst >::Iterator(Node *node, BucketStorage< Node > *nodes) :
+	node(node), nodes(nodes)
+{
+}
+
+template< typename K, typename V, typename Hash, typename KeyEqual >
+template< bool IsConst >
+template< bool WasConst, typename >
+BucketHashMap< K, V, Hash, KeyEqual >::Iterator< IsConst >::Iterator(const Iterator< WasConst > &other) :
+	node(other.node), nodes(other.nodes)
+{
+}
+
+template< typename K, typename V, typename Hash, typename KeyEqual >
+template< bool IsConst >
+typename BucketHashMap< K, V, Hash, KeyEqual >::template Iterator< IsConst >::reference
+	BucketHashMap< K, V, Hash, KeyEqual >::Iterator< IsConst >::operator*() const
+{
+	if (!node)
+		throw std::out_of_range("Attempted to dereference end() iterator.");
+	return node->entry;
+}
+
+template< typename K, typename V, typename Hash, typename KeyEqual >
+template< bool IsConst >
+typename BucketHashMap< K, V, Hash, KeyEqual >::template Iterator< IsConst >::pointer
+	BucketHashMap< K, V, Hash, KeyEqual >::Iterator< IsConst >::operator->() const
+{
+	if (!node)
+		throw std::out_of_range("Attempted to dereference end() iterator.");
+	return &node->entry;
+}
+
+template< typename K, typename V, typename Hash, typename KeyEqual >
+template< bool IsConst >
+typename BucketHashMap< K, V, Hash, KeyEqual >::template Iterator< IsConst > &
+	BucketHashMap< K, V, Hash, KeyEqual >::Iterator< IsConst >::operator++()
+{
+	if (!node)
+		throw std::out_of_range("Iterator cannot be incremented.");
+	BucketStorageIterator< Node > next = std::next(node->position);
+	node = next == nodes->end() ? nullptr : &*next;
+	return *this;
+}
+
+template< typename K, typename V, typename Hash, typename KeyEqual >
+template< bool IsConst >
+typename BucketHashMap< K, V, Hash, KeyEqual >::template Iterator< IsConst >
+	BucketHashMap< K, V, Hash, KeyEqual >::Iterator< IsConst >::operator++(int)
+{
+	Iterator temp = *this;
+	++*this;
+	return temp;
+}
+
+template< typename K, typename V, typename Hash, typename KeyEqual >
+template< bool IsConst >
+bool BucketHashMap< K, V, Hash, KeyEqual >::Iterator< IsConst >::operator==(const Iterator &other) const
+{
+	return node == other.node;
+}
+
+template< typename K, typename V, typename Hash, typename KeyEqual >
+template< bool IsConst >
+bool BucketHashMap< K, V, Hash, KeyEqual >::Iterator< IsConst >::operator!=(const Iterator &other) const
+{
+	return node != other.node;
+}
+
+template< typename K, typename V, typename Hash, typename KeyEqual >
+BucketHashMap< K, V, Hash, KeyEqual >::BucketHashMap() : BucketHashMap(MIN_BUCKET_COUNT)
+{
+}
+
+template< typename K, typename V, typename Hash, typename KeyEqual >
+BucketHashMap< K, V, Hash, KeyEqual >::BucketHashMap(size_t bucket_count) :
+	buckets(nullptr), buckets_count(0), bucket_shift(0), max_load(1.0f)
+{
+	rehash(bucket_count);
+}
+
+template< typename K, typename V, typename Hash, typename KeyEqual >
+BucketHashMap< K, V, Hash, KeyEqual >::BucketHashMap(const BucketHashMap &other) :
+	buckets(nullptr), buckets_count(0), bucket_shift(0), max_load(other.max_load), hash_function(other.hash_function),
+	key_equal_function(other.key_equal_function)
+{
+	rehash(other.buckets_count);
+	for (const_iterator it = other.begin(); it != other.end(); ++it)
+		insert(*it);
+}
+
+template< typename K, typename V, typename Hash, typename KeyEqual >
+BucketHashMap< K, V, Hash, KeyEqual >::BucketHashMap(BucketHashMap &&other) noexcept :
+	nodes(std::move(other.nodes)), buckets(other.buckets), buckets_count(other.buckets_count),
+	bucket_shift(other.bucket_shift), max_load(other.max_load), hash_function(std::move(other.hash_function)),
+	key_equal_function(std::move(other.key_equal_function))
+{
+	other.buckets = nullptr;
+	other.buckets_count = 0;
+	other.bucket_shift = 0;
+}
+
+template< typename K, typename V, typename Hash, typename KeyEqual >
+BucketHashMap< K, V, Hash, KeyEqual >::~BucketHashMap()
+{
+	delete[] buckets;
+}
+
+template< typename K, typename V, typename Hash, typename KeyEqual >
+BucketHashMap< K, V, Hash, KeyEqual > &BucketHashMap< K, V, Hash, KeyEqual >::operator=(const BucketHashMap &other)
+{
+	if (this != &other)
+	{
+		BucketHashMap temp(other);
+		swap(temp);
+	}
+	return *this;
+}
+
+template< typename K, typename V, typename Hash, typename KeyEqual >
+BucketHashMap< K, V, Hash, KeyEqual > &BucketHashMap< K, V, Hash, KeyEqual >::operator=(BucketHashMap &&other) noexcept
+{
+	if (this != &other)
+	{
+		BucketHashMap temp(std::move(other));
+		swap(temp);
+	}
+	return *this;
+}
+
+template< typename K, typename V, typename Hash, typename KeyEqual >
+std::pair< typename BucketHashMap< K, V, Hash, KeyEqual >::iterator, bool >
+	BucketHashMap< K, V, Hash, KeyEqual >::insert(const value_type &value)
+{
+	return emplace_unique(value.first, value.second);
+}
+
+template< typename K, typename V, typename Hash, typename KeyEqual >
+std::pair< typename BucketHashMap< K, V, Hash, KeyEqual >::iterator, bool >
+	BucketHashMap< K, V, Hash, KeyEqual >::insert(value_type &&value)
+{
+	return emplace_unique(std::move(const_cast< key_type & >(value.first)), std::move(value.second));
+}
+
+template< typename K, typename V, typename Hash, typename KeyEqual >
+template< typename... Args >
+std::pair< typename BucketHashMap< K, V, Hash, KeyEqual >::iterator, bool >
+	BucketHashMap< K, V, Hash, KeyEqual >::try_emplace(const key_type &key, Args &&...args)
+{
+	return emplace_unique(key, std::forward< Args >(args)...);
+}
+
+template< typename K, typename V, typename Hash, typename KeyEqual >
+template< typename... Args >
+std::pair< typename BucketHashMap< K, V, Hash, KeyEqual >::iterator, bool >
+	BucketHashMap< K, V, Hash, KeyEqual >::try_emplace(key_type &&key, Args &&...args)
+{
+	return emplace_unique(std::move(key), std::forward< Args >(args)...);
+}
+
+template< typename K, typename V, typename Hash, typename KeyEqual >
+typename BucketHashMap< K, V, Hash, KeyEqual >::mapped_type &
+	BucketHashMap< K, V, Hash, KeyEqual >::operator[](const key_type &key)
+{
+	return emplace_unique(key).first->second;
+}
+
+template< typename K, typename V, typename Hash, typename KeyEqual >
+typename BucketHashMap< K, V, Hash, KeyEqual >::mapped_type &
+	BucketHashMap< K, V, Hash, KeyEqual >::operator[](key_type &&key)
+{
+	return emplace_unique(std::move(key)).first->second;
+}
+
+template< typename K, typename V, typename Hash, typename KeyEqual >
+typename BucketHashMap< K, V, Hash, KeyEqual >::mapped_type &
+	BucketHashMap< K, V, Hash, KeyEqual >::at(const key_type &key)
+{
+	Node *node = find_node(key, hash_function(key));
+	if (!node)
+	{
+		throw std::out_of_range("Key not found");
+	}
+	return node->entry.second;
+}
+
+template< typename K, typename V, typename Hash, typename KeyEqual >
+const typename BucketHashMap< K, V, Hash, KeyEqual >::mapped_type &
+	BucketHashMap< K, V, Hash, KeyEqual >::at(const key_type &key) const
+{
+	Node *node = find_node(key, hash_function(key));
+	if (!node)
+	{
+		throw std::out_of_range("Key not found");
+	}
+	return node->entry.second;
+}
+
+template< typename K, typename V, typename Hash, typename KeyEqual >
+typename BucketHashMap< K, V, Hash, KeyEqual >::iterator
+	BucketHashMap< K, V, Hash, KeyEqual >::find(const key_type &key)
+{
+	Node *node = find_node(key, hash_function(key));
+	return node ? iterator(node, &nodes) : end();
+}
+
+template< typename K, typename V, typename Hash, typename KeyEqual >
+typename BucketHashMap< K, V, Hash, KeyEqual >::const_iterator
+	BucketHashMap< K, V, Hash, KeyEqual >::find(const key_type &key) const
+{
+	Node *node = find_node(key, hash_function(key));
+	return node ? const_iterator(node, const_cast< BucketStorage< Node > * >(&nodes)) : end();
+}
+
+template< typename K, typename V, typename Hash, typename KeyEqual >
+bool BucketHashMap< K, V, Hash, KeyEqual >::contains(const key_type &key) const
+{
+	return find_node(key, hash_function(key)) != nullptr;
+}
+
+template< typename K, typename V, typename Hash, typename KeyEqual >
+typename BucketHashMap< K, V, Hash, KeyEqual >::size_type
+	BucketHashMap< K, V, Hash, KeyEqual >::count(const key_type &key) const
+{
+	return contains(key) ? 1 : 0;
+}
+
+template< typename K, typename V, typename Hash, typename KeyEqual >
+typename BucketHashMap< K, V, Hash, KeyEqual >::iterator BucketHashMap< K, V, Hash, KeyEqual >::erase(const_iterator it)
+{
+	if (it == end())
+	{
+		throw std::out_of_range("Attempted to erase end() iterator");
+	}
+	unlink_node(it.node);
+	return make_iterator(nodes.erase(it.node->position));
+}
+
+template< typename K, typename V, typename Hash, typename KeyEqual >
+typename BucketHashMap< K, V, Hash, KeyEqual >::size_type
+	BucketHashMap< K, V, Hash, KeyEqual >::erase(const key_type &key)
+{
+	Node *node = find_node(key, hash_function(key));
+	if (!node)
+		return 0;
+	unlink_node(node);
+	nodes.erase(node->position);
+	return 1;
+}
+
+template< typename K, typename V, typename Hash, typename KeyEqual >
+void BucketHashMap< K, V, Hash, KeyEqual >::clear()
+{
+	nodes.clear();
+	for (size_t i = 0; i < buckets_count; ++i)
+		buckets[i] = nullptr;
+}
+
+template< typename K, typename V, typename Hash, typename KeyEqual >
+void BucketHashMap< K, V, Hash, KeyEqual >::swap(BucketHashMap &other) noexcept
+{
+	using std::swap;
+	nodes.swap(other.nodes);
+	swap(buckets, other.buckets);
+	swap(buckets_count, other.buckets_count);
+	swap(bucket_shift, other.bucket_shift);
+	swap(max_load, other.max_load);
+	swap(hash_function, other.hash_function);
+	swap(key_equal_function, other.key_equal_function);
+}
+
+template< typename K, typename V, typename Hash, typename KeyEqual >
+void BucketHashMap< K, V, Hash, KeyEqual >::rehash(size_t bucket_count)
+{
+	size_t minimum = static_cast< size_t >(static_cast< float >(nodes.size()) / max_load) + 1;
+	size_t new_count = MIN_BUCKET_COUNT;
+	unsigned new_shift = 64 - 3;
+	while (new_count < bucket_count || new_count < minimum)
+	{
+		new_count *= 2;
+		--new_shift;
+	}
+	if (new_count == buckets_count)
+		return;
+
+	Node **new_buckets = new Node *[new_count]();
+	delete[] buckets;
+	buckets = new_buckets;
+	buckets_count = new_count;
+	bucket_shift = new_shift;
+	for (auto it = nodes.begin(); it != nodes.end(); ++it)
+	{
+		Node &node = *it;
+		Node *&head = buckets[bucket_index(node.hash)];
+		node.next = head;
+		head = &node;
+	}
+}
+
+template< typename K, typename V, typename Hash, typename KeyEqual >
+void BucketHashMap< K, V, Hash, KeyEqual >::reserve(size_t count)
+{
+	rehash(static_cast< size_t >(static_cast< float >(count) / max_load) + 1);
+}
+
+template< typename K, typename V, typename Hash, typename KeyEqual >
+bool BucketHashMap< K, V, Hash, KeyEqual >::empty() const noexcept
+{
+	return nodes.empty();
+}
+
+template< typename K, typename V, typename Hash, typename KeyEqual >
+typename BucketHashMap< K, V, Hash, KeyEqual >::size_type BucketHashMap< K, V, Hash, KeyEqual >::size() const noexcept
+{
+	return nodes.size();
+}
+
+template< typename K, typename V, typename Hash, typename KeyEqual >
+typename BucketHashMap< K, V, Hash, KeyEqual >::size_type
+	BucketHashMap< K, V, Hash, KeyEqual >::bucket_count() const noexcept
+{
+	return buckets_count;
+}
+
+template< typename K, typename V, typename Hash, typename KeyEqual >
+float BucketHashMap< K, V, Hash, KeyEqual >::load_factor() const noexcept
+{
+	return buckets_count ? static_cast< float >(nodes.size()) / static_cast< float >(buckets_count) : 0.0f;
+}
+
+template< typename K, typename V, typename Hash, typename KeyEqual >
+float BucketHashMap< K, V, Hash, KeyEqual >::max_load_factor() const noexcept
+{
+	return max_load;
+}
+
+template< typename K, typename V, typename Hash, typename KeyEqual >
+void BucketHashMap< K, V, Hash, KeyEqual >::max_load_factor(float factor)
+{
+	if (!(factor > 0.0f))
+	{
+		throw std::invalid_argument("Max load factor must be positive");
+	}
+	max_load = factor;
+	rehash(0);
+}
+
+template< typename K, typename V, typename Hash, typename KeyEqual >
+typename BucketHashMap< K, V, Hash, KeyEqual >::iterator BucketHashMap< K, V, Hash, KeyEqual >::begin() noexcept
+{
+	return make_iterator(nodes.begin());
+}
+
+template< typename K, typename V, typename Hash, typename KeyEqual >
+typename BucketHashMap< K, V, Hash, KeyEqual >::iterator BucketHashMap< K, V, Hash, KeyEqual >::end() noexcept
+{
+	return iterator(nullptr, &nodes);
+}
+
+template< typename K, typename V, typename Hash, typename KeyEqual >
+typename BucketHashMap< K, V, Hash, KeyEqual >::const_iterator
+	BucketHashMap< K, V, Hash, KeyEqual >::begin() const noexcept
+{
+	return const_cast< BucketHashMap * >(this)->begin();
+}
+
+template< typename K, typename V, typename Hash, typename KeyEqual >
+typename BucketHashMap< K, V, Hash, KeyEqual >::const_iterator
+	BucketHashMap< K, V, Hash, KeyEqual >::end() const noexcept
+{
+	return const_cast< BucketHashMap * >(this)->end();
+}
+
+template< typename K, typename V, typename Hash, typename KeyEqual >
+typename BucketHashMap< K, V, Hash, KeyEqual >::const_iterator
+	BucketHashMap< K, V, Hash, KeyEqual >::cbegin() const noexcept
+{
+	return begin();
+}
+
+template< typename K, typename V, typename Hash, typename KeyEqual >
+typename BucketHashMap< K, V, Hash, KeyEqual >::const_iterator
+	BucketHashMap< K, V, Hash, KeyEqual >::cend() const noexcept
+{
+	return end();
+}
+
+template< typename K, typename V, typename Hash, typename KeyEqual >
+size_t BucketHashMap< K, V, Hash, KeyEqual >::bucket_index(size_t hash) const noexcept
+{
+	return static_cast< size_t >((static_cast< uint64_t >(hash) * UINT64_C(0x9E3779B97F4A7C15)) >> bucket_shift);
+}
+
+template< typename K, typename V, typename Hash, typename KeyEqual >
+typename BucketHashMap< K, V, Hash, KeyEqual >::iterator
+	BucketHashMap< K, V, Hash, KeyEqual >::make_iterator(BucketStorageIterator< Node > position) noexcept
+{
+	return iterator(position == nodes.end() ? nullptr : &*position, &nodes);
+}
+
+template< typename K, typename V, typename Hash, typename KeyEqual >
+typename BucketHashMap< K, V, Hash, KeyEqual >::Node *
+	BucketHashMap< K, V, Hash, KeyEqual >::find_node(const key_type &key, size_t hash) const
+{
+	if (!buckets)
+		return nullptr;
+	for (Node *node = buckets[bucket_index(hash)]; node; node = node->next)
+	{
+		if (node->hash == hash && key_equal_function(node->entry.first, key))
+			return node;
+	}
+	return nullptr;
+}
+
+template< typename K, typename V, typename Hash, typename KeyEqual >
+template< typename KeyArg, typename... Args >
+std::pair< typename BucketHashMap< K, V, Hash, KeyEqual >::iterator, bool >
+	BucketHashMap< K, V, Hash, KeyEqual >::emplace_unique(KeyArg &&key, Args &&...args)
+{
+	size_t hash = hash_function(key);
+	if (Node *existing = find_node(key, hash))
+		return { iterator(existing, &nodes), false };
+
+	if (static_cast< float >(nodes.size() + 1) > max_load * static_cast< float >(buckets_count))
+		rehash(buckets_count * 2);
+
+	auto position = nodes.emplace(
+		hash,
+		std::piecewise_construct,
+		std::forward_as_tuple(std::forward< KeyArg >(key)),
+		std::forward_as_tuple(std::forward< Args >(args)...));
+	Node &node = *position;
+	node.position = position;
+	Node *&head = buckets[bucket_index(hash)];
+	node.next = head;
+	head = &node;
+	return { iterator(&node, &nodes), true };
+}
+
+template< typename K, typename V, typename Hash, typename KeyEqual >
+void BucketHashMap< K, V, Hash, KeyEqual >::unlink_node(Node *node)
+{
+	Node **link = &buckets[bucket_index(node->hash)];
+	while (*link != node)
+		link = &(*link)->next;
+	*link = node->next;
+}
+
+#endif /* BUCKET_HASH_MAP_HPP */
@@ -0,0 +1,364 @@
+#ifndef BUCKET_LRU_HPP
+#define BUCKET_LRU_HPP
+
+#include "bucket_storage.hpp"
+
+#include <cstdint>
+#include <functional>
+#include <stdexcept>
+#include <utility>
+
+// Bounded least-recently-used cache. Entries live in BucketStorage slots and are linked into an intrusive hash
+// chain and recency list; once full, the least recently used entry's slot is reused for the incoming one.
+template< typename K, typename V, typename Hash = std::hash< K >, typename KeyEqual = std::equal_to< K > >
+class BucketLRU
+{
+  public:
+	using key_type = K;
+	using mapped_type = V;
+	using size_type = std::size_t;
+
+	explicit BucketLRU(size_t capacity);
+
+	BucketLRU(const BucketLRU &other) = delete;
+
+	BucketLRU(BucketLRU &&other) noexcept;
+
+	~BucketLRU();
+
+	BucketLRU &operator=(const BucketLRU &other) = delete;
+
+	BucketLRU &operator=(BucketLRU &&other) noexcept;
+
+	mapped_type *get(const key_type &key);
+
+	[[nodiscard]] bool contains(const key_type &key) const;
+
+	template< typename KeyArg, typename ValueArg >
+	mapped_type &put(KeyArg &&key, ValueArg &&value);
+
+	bool erase(const key_type &key);
+
+	void clear();
+
+	void swap(BucketLRU &other) noexcept;
+
+	[[nodiscard]] bool empty() const noexcept;
+
+	[[nodiscard]] size_type size() const noexcept;
+
+	[[nodiscard]] size_type capacity() const noexcept;
+
+	[[nodiscard]] size_t hits() const noexcept;
+
+	[[nodiscard]] size_t misses() const noexcept;
+
+	template< typename Visitor >
+	void for_each(Visitor &&visitor) const;
+
+  private:
+	struct Node
+	{
+		K key;
+		V value;
+		size_t hash;
+		Node *chain_next;
+		Node *newer;
+		Node *older;
+		BucketStorageIterator< Node > position;
+
+		template< typename KeyArg, typename ValueArg >
+		Node(size_t hash, KeyArg &&key, ValueArg &&value);
+	};
+
+	size_t bucket_index(size_t hash) const noexcept;
+
+	Node *find_node(const key_type &key, size_t hash) const;
+
+	void link_chain(Node *node) noexcept;
+
+	void unlink_chain(Node *node) noexcept;
+
+	void link_front(Node *node) noexcept;
+
+	void unlink_recency(Node *node) noexcept;
+
+	void remove_node(Node *node);
+
+	BucketStorage< Node > nodes;
+	Node **buckets;
+	size_t buckets_count;
+	unsigned bucket_shift;
+	size_t max_entries;
+	Node *most_recent;
+	Node *least_recent;
+	size_t hit_count;
+	size_t miss_count;
+	Hash hash_function;
+	KeyEqual key_equal_function;
+};
+
+template< typename K, typename V, typename Hash, typename KeyEqual >
+template< typename KeyArg, typename ValueArg >
+BucketLRU< K, V, Hash, KeyEqual >::Node::Node(size_t hash, KeyArg &&key, ValueArg &&value) :
+	key(std::forward< KeyArg >(key)), value(std::forward< ValueArg >(value)), hash(hash), chain_next(nullptr),
+	newer(nullptr), older(nullptr), position(nullptr, nullptr)
+{
+}
+
+template< typename K, typename V, typename Hash, typename KeyEqual >
+BucketLRU< K, V, Hash, KeyEqual >::BucketLRU(size_t capacity) :
+	nodes(capacity > 0 && capacity < 64 ? capacity : 64), buckets(nullptr), buckets_count(8), bucket_shift(64 - 3),
+	max_entries(capacity), most_recent(nullptr), least_recent(nullptr), hit_count(0), miss_count(0)
+{
+	if (capacity == 0)
+	{
+		throw std::invalid_argument("Cache capacity must be greater than 0");
+	}
+	while (buckets_count < capacity)
+	{
+		buckets_count *= 2;
+		--bucket_shift;
+	}
+	buckets = new Node *[buckets_count]();
+}
+
+template< typename K, typename V, typename Hash, typename KeyEqual >
+BucketLRU< K, V, Hash, KeyEqual >::BucketLRU(BucketLRU &&other) noexcept :
+	nodes(std::move(other.nodes)), buckets(other.buckets), buckets_count(other.buckets_count),
+	bucket_shift(other.bucket_shift), max_entries(other.max_entries), most_recent(other.most_recent),
+	least_recent(other.least_recent), hit_count(other.hit_count), miss_count(other.miss_count),
+	hash_function(std::move(other.hash_function)), key_equal_function(std::move(other.key_equal_function))
+{
+	other.buckets = nullptr;
+	other.buckets_count = 0;
+	other.most_recent = nullptr;
+	other.least_recent = nullptr;
+}
+
+template< typename K, typename V, typename Hash, typename KeyEqual >
+BucketLRU< K, V, Hash, KeyEqual >::~BucketLRU()
+{
+	delete[] buckets;
+}
+
+template< typename K, typename V, typename Hash, typename KeyEqual >
+BucketLRU< K, V, Hash, KeyEqual > &BucketLRU< K, V, Hash, KeyEqual >::operator=(BucketLRU &&other) noexcept
+{
+	if (this != &other)
+	{
+		BucketLRU temp(std::move(other));
+		swap(temp);
+	}
+	return *this;
+}
+
+template< typename K, typename V, typename Hash, typename KeyEqual >
+typename BucketLRU< K, V, Hash, KeyEqual >::mapped_type *BucketLRU< K, V, Hash, KeyEqual >::get(const key_type &key)
+{
+	Node *node = find_node(key, hash_function(key));
+	if (!node)
+	{
+		++miss_count;
+		return nullptr;
+	}
+	++hit_count;
+	if (node != most_recent)
+	{
+		unlink_recency(node);
+		link_front(node);
+	}
+	return &node->value;
+}
+
+template< typename K, typename V, typename Hash, typename KeyEqual >
+bool BucketLRU< K, V, Hash, KeyEqual >::contains(const key_type &key) const
+{
+	return find_node(key, hash_function(key)) != nullptr;
+}
+
+template< typename K, typename V, typename Hash, typename KeyEqual >
+template< typename KeyArg, typename ValueArg >
+typename BucketLRU< K, V, Hash, KeyEqual >::mapped_type &
+	BucketLRU< K, V, Hash, KeyEqual >::put(KeyArg &&key, ValueArg &&value)
+{
+	size_t hash = hash_function(key);
+	Node *node = find_node(key, hash);
+	if (node)
+	{
+		node->value = std::forward< ValueArg >(value);
+		unlink_recency(node);
+	}
+	else if (nodes.size() == max_entries)
+	{
+		node = least_recent;
+		unlink_chain(node);
+		unlink_recency(node);
+		try
+		{
+			node->key = std::forward< KeyArg >(key);
+			node->value = std::forward< ValueArg >(value);
+		} catch (...)
+		{
+			nodes.erase(node->position);
+			throw;
+		}
+		node->hash = hash;
+		link_chain(node);
+	}
+	else
+	{
+		auto position = nodes.emplace(hash, std::forward< KeyArg >(key), std::forward< ValueArg >(value));
+		node = &*position;
+		node->position = position;
+		link_chain(node);
+	}
+	link_front(node);
+	return node->value;
+}
+
+template< typename K, typename V, typename Hash, typename KeyEqual >
+bool BucketLRU< K, V, Hash, KeyEqual >::erase(const key_type &key)
+{
+	Node *node = find_node(key, hash_function(key));
+	if (!node)
+		return false;
+	remove_node(node);
+	return true;
+}
+
+template< typename K, typename V, typename Hash, typename KeyEqual >
+void BucketLRU< K, V, Hash, KeyEqual >::clear()
+{
+	nodes.clear();
+	for (size_t i = 0; i < buckets_count; ++i)
+		buckets[i] = nullptr;
+	most_recent = least_recent = nullptr;
+}
+
+template< typename K, typename V, typename Hash, typename KeyEqual >
+void BucketLRU< K, V, Hash, KeyEqual >::swap(BucketLRU &other) noexcept
+{
+	using std::swap;
+	nodes.swap(other.nodes);
+	swap(buckets, other.buckets);
+	swap(buckets_count, other.buckets_count);
+	swap(bucket_shift, other.bucket_shift);
+	swap(max_entries, other.max_entries);
+	swap(most_recent, other.most_recent);
+	swap(least_recent, other.least_recent);
+	swap(hit_count, other.hit_count);
+	swap(miss_count, other.miss_count);
+	swap(hash_function, other.hash_function);
+	swap(key_equal_function, other.key_equal_function);
+}
+
+template< typename K, typename V, typename Hash, typename KeyEqual >
+bool BucketLRU< K, V, Hash, KeyEqual >::empty() const noexcept
+{
+	return nodes.empty();
+}
+
+template< typename K, typename V, typename Hash, typename KeyEqual >
+typename BucketLRU< K, V, Hash, KeyEqual >::size_type BucketLRU< K, V, Hash, KeyEqual >::size() const noexcept
+{
+	return nodes.size();
+}
+
+template< typename K, typename V, typename Hash, typename KeyEqual >
+typename BucketLRU< K, V, Hash, KeyEqual >::size_type BucketLRU< K, V, Hash, KeyEqual >::capacity() const noexcept
+{
+	return max_entries;
+}
+
+template< typename K, typename V, typename Hash, typename KeyEqual >
+size_t BucketLRU< K, V, Hash, KeyEqual >::hits() const noexcept
+{
+	return hit_count;
+}
+
+template< typename K, typename V, typename Hash, typename KeyEqual >
+size_t BucketLRU< K, V, Hash, KeyEqual >::misses() const noexcept
+{
+	return miss_count;
+}
+
+template< typename K, typename V, typename Hash, typename KeyEqual >
+template< typename Visitor >
+void BucketLRU< K, V, Hash, KeyEqual >::for_each(Visitor &&visitor) const
+{
+	for (const Node *node = most_recent; node; node = node->older)
+		visitor(static_cast< const K & >(node->key), static_cast< const V & >(node->value));
+}
+
+template< typename K, typename V, typename Hash, typename KeyEqual >
+size_t BucketLRU< K, V, Hash, KeyEqual >::bucket_index(size_t hash) const noexcept
+{
+	return static_cast< size_t >((static_cast< uint64_t >(hash) * UINT64_C(0x9E3779B97F4A7C15)) >> bucket_shift);
+}
+
+template< typename K, typename V, typename Hash, typename KeyEqual >
+typename BucketLRU< K, V, Hash, KeyEqual >::Node *
+	BucketLRU< K, V, Hash, KeyEqual >::find_node(const key_type &key, size_t hash) const
+{
+	if (!buckets)
+		return nullptr;
+	for (Node *node = buckets[bucket_index(hash)]; node; node = node->chain_next)
+	{
+		if (node->hash == hash && key_equal_function(node->key, key))
+			return node;
+	}
+	return nullptr;
+}
+
+template< typename K, typename V, typename Hash, typename KeyEqual >
+void BucketLRU< K, V, Hash, KeyEqual >::link_chain(Node *node) noexcept
+{
+	Node *&head = buckets[bucket_index(node->hash)];
+	node->chain_next = head;
+	head = node;
+}
+
+template< typename K, typename V, typename Hash, typename KeyEqual >
+void BucketLRU< K, V, Hash, KeyEqual >::unlink_chain(Node *node) noexcept
+{
+	Node **link = &buckets[bucket_index(node->hash)];
+	while (*link != node)
+		link = &(*link)->chain_next;
+	*link = node->chain_next;
+}
+
+template< typename K, typename V, typename Hash, typename KeyEqual >
+void BucketLRU< K, V, Hash, KeyEqual >::link_front(Node *node) noexcept
+{
+	node->newer = nullptr;
+	node->older = most_recent;
+	if (most_recent)
+		most_recent->newer = node;
+	else
+		least_recent = node;
+	most_recent = node;
+}
+
+template< typename K, typename V, typename Hash, typename KeyEqual >
+void BucketLRU< K, V, Hash, KeyEqual >::unlink_recency(Node *node) noexcept
+{
+	if (node->newer)
+		node->newer->older = node->older;
+	else
+		most_recent = node->older;
+	if (node->older)
+		node->older->newer = node->newer;
+	else
+		least_recent = node->newer;
+}
+
+template< typename K, typename V, typename Hash, typename KeyEqual >
+void BucketLRU< K, V, Hash, KeyEqual >::remove_node(Node *node)
+{
+	unlink_chain(node);
+	unlink_recency(node);
+	nodes.erase(node->position);
+}
+
+#endif /* BUCKET_LRU_HPP */
@@ -1,16 +1,74 @@
 #ifndef BUCKET_STORAGE_HPP
 #define BUCKET_STORAGE_HPP
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <compare>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <functional>
+#include <memory>
 #include <new>
+#include <numeric>
 #include <stdexcept>
+#include <thread>
+#include <type_traits>
 #include <utility>
+#include <vector>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <xmmintrin.h>
+#endif
+
+template< typename P >
+P load_acquire(const P &field) noexcept
+{
+	return std::atomic_ref< P >(const_cast< P & >(field)).load(std::memory_order_acquire);
+}
+
+template< typename P >
+void store_release(P &field, P value) noexcept
+{
+	std::atomic_ref< P >(field).store(value, std::memory_order_release);
+}
+
+// Types whose objects can be moved by copying their bytes and never destroying the source. Specialize it for
+// types that are not trivially copyable but still relocate this way, such as owning handles.
+template< typename T >
+struct is_trivially_relocatable : std::is_trivially_copyable< T >
+{
+};
+
+template< typename T >
+inline constexpr bool is_trivially_relocatable_v = is_trivially_relocatable< T >::value;
+
+inline void prefetch_for_read(const void *address) noexcept
+{
+#if defined(__GNUC__) || defined(__clang__)
+	__builtin_prefetch(address, 0, 3);
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+	_mm_prefetch(static_cast< const char * >(address), _MM_HINT_T0);
+#else
+	(void)address;
+#endif
+}
+
+template< typename T >
+class LinkedStack;
 
 template< typename T >
 class Block
 {
   private:
+	struct FreeSlot
+	{
+		FreeSlot *next;
+	};
+
 	size_t block_elements_counter;
+	size_t block_tombstones_counter;
 	size_t capacity;
 	Block &operator=(const Block< T > &other);
 	Block &operator=(Block< T > &&other) noexcept;
@@ -21,43 +79,82 @@ class Block
 		T element_data;
 		Element *prev_element;
 		Element *next_element;
+		bool tombstone;
 
 		Element(const T &data, Element *prev, Element *next);
 
 		Element(T &&data, Element *prev, Element *next);
+
+		template< typename... Args >
+		explicit Element(std::in_place_t, Args &&...args);
 	};
 
 	Element *head_element;
 	Element *tail_element;
 	Block *prev_block;
 	Block *next_block;
+	typename LinkedStack< T >::Node *stack_node;
+	size_t affinity_slot;
+	size_t prefetch_distance;
 
 	explicit Block(size_t cap);
+	Block(const Block &other);
 	~Block();
 	[[nodiscard]] bool is_full() const;
 	[[nodiscard]] bool is_empty() const noexcept;
-	template< typename U >
-	void insert_element_general(U &&value);
+	[[nodiscard]] size_t get_capacity() const noexcept;
+	[[nodiscard]] size_t get_size() const noexcept;
+	[[nodiscard]] size_t get_tombstones() const noexcept;
+	[[nodiscard]] const Element *prefetch_target(const Element *element) const noexcept;
+	template< typename... Args >
+	void insert_element_general(Args &&...args);
+	void unlink_element(Element *element);
 	void remove_element(Element *element);
-	void clear();
+	void release_slot(Element *element) noexcept;
+	[[nodiscard]] size_t relocation_room() const noexcept;
+	void reserve_slots();
+	void relocate_run(Element *first, size_t count);
+	void discard_relocated() noexcept;
+	void mark_erased(Element *element);
+	template< typename Dispose >
+	size_t compact(Dispose &&dispose);
+	[[nodiscard]] bool has_tombstones() const noexcept;
+
+  private:
+	Element *slots;
+	size_t used_slots;
+	FreeSlot *free_slots;
+
+	void *acquire_slot();
+	void return_slot(void *slot) noexcept;
+	void destroy_slots() noexcept;
+	void copy_slots(const Block &other);
 };
 
 template< typename T >
 Block< T >::Element::Element(const T &data, Element *prev, Element *next) :
-	element_data(data), prev_element(prev), next_element(next)
+	element_data(data), prev_element(prev), next_element(next), tombstone(false)
 {
 }
 
 template< typename T >
 Block< T >::Element::Element(T &&data, Element *prev, Element *next) :
-	element_data(std::move(data)), prev_element(prev), next_element(next)
+	element_data(std::move(data)), prev_element(prev), next_element(next), tombstone(false)
+{
+}
+
+template< typename T >
+template< typename... Args >
+Block< T >::Element::Element(std::in_place_t, Args &&...args) :
+	element_data(std::forward< Args >(args)...), prev_element(nullptr), next_element(nullptr), tombstone(false)
 {
 }
 
 template< typename T >
 Block< T >::Block(size_t cap) :
-	head_element(nullptr), tail_element(nullptr), prev_block(nullptr), next_block(nullptr), block_elements_counter(0),
-	capacity(cap)
+	block_elements_counter(0), block_tombstones_counter(0), capacity(cap), head_element(nullptr), tail_element(nullptr),
+	prev_block(nullptr), next_block(nullptr), stack_node(nullptr), affinity_slot(SIZE_MAX), prefetch_distance(0),
+	slots(nullptr), used_slots(0), free_slots(nullptr)
 {
 	if (cap == 0)
 	{
@@ -65,6 +162,15 @@ Block< T >::Block(size_t cap) :
 	}
 }
 
+template< typename T >
+Block< T >::Block(const Block &other) :
+	block_elements_counter(0), block_tombstones_counter(0), capacity(other.capacity), head_element(nullptr),
+	tail_element(nullptr), prev_block(nullptr), next_block(nullptr), stack_node(nullptr), affinity_slot(SIZE_MAX),
+	prefetch_distance(other.prefetch_distance), slots(nullptr), used_slots(0), free_slots(nullptr)
+{
+	copy_slots(other);
+}
+
 template< typename T >
 Block< T > &Block< T >::operator=(const Block< T > &other)
 {
@@ -89,13 +195,180 @@ Block< T > &Block< T >::operator=(Block< T > &&other) noexcept
 template< typename T >
 Block< T >::~Block()
 {
-	clear();
+	destroy_slots();
+}
+
+template< typename T >
+void *Block< T >::acquire_slot()
+{
+	if (free_slots)
+	{
+		FreeSlot *slot = free_slots;
+		free_slots = slot->next;
+		return slot;
+	}
+	if (!slots)
+		slots = std::allocator< Element >().allocate(capacity);
+	return slots + used_slots++;
+}
+
+template< typename T >
+void Block< T >::return_slot(void *slot) noexcept
+{
+	free_slots = ::new (slot) FreeSlot{ free_slots };
+}
+
+template< typename T >
+void Block< T >::release_slot(Element *element) noexcept
+{
+	element->~Element();
+	return_slot(element);
+}
+
+template< typename T >
+size_t Block< T >::relocation_room() const noexcept
+{
+	return free_slots ? 1 : capacity - used_slots;
+}
+
+template< typename T >
+void Block< T >::reserve_slots()
+{
+	if (!slots)
+		slots = std::allocator< Element >().allocate(capacity);
+}
+
+template< typename T >
+void Block< T >::relocate_run(Element *first, size_t count)
+{
+	if (count == 0 || count > relocation_room())
+	{
+		throw std::logic_error("Relocated run exceeds the free slots of the block");
+	}
+	Element *target = static_cast< Element * >(acquire_slot());
+	used_slots += count - 1;
+	std::memcpy(static_cast< void * >(target), static_cast< const void * >(first), count * sizeof(Element));
+	for (size_t i = 0; i < count; ++i)
+	{
+		target[i].prev_element = i ? target + i - 1 : tail_element;
+		target[i].next_element = i + 1 < count ? target + i + 1 : nullptr;
+		target[i].tombstone = false;
+	}
+	if (!head_element)
+		store_release(head_element, target);
+	else
+		store_release(tail_element->next_element, target);
+	tail_element = target + count - 1;
+	block_elements_counter += count;
+}
+
+template< typename T >
+void Block< T >::discard_relocated() noexcept
+{
+	if constexpr (!std::is_trivially_destructible_v< T >)
+	{
+		for (Element *current = head_element; current;)
+		{
+			Element *next = current->next_element;
+			if (current->tombstone)
+				current->~Element();
+			current = next;
+		}
+	}
+	if (slots)
+		std::allocator< Element >().deallocate(slots, capacity);
+	head_element = tail_element = nullptr;
+	slots = nullptr;
+	used_slots = 0;
+	free_slots = nullptr;
+	block_elements_counter = 0;
+	block_tombstones_counter = 0;
+}
+
+template< typename T >
+void Block< T >::destroy_slots() noexcept
+{
+	if constexpr (!std::is_trivially_destructible_v< T >)
+	{
+		for (Element *current = head_element; current;)
+		{
+			Element *next = current->next_element;
+			current->~Element();
+			current = next;
+		}
+	}
+	if (slots)
+		std::allocator< Element >().deallocate(slots, capacity);
+	slots = nullptr;
+	used_slots = 0;
+	free_slots = nullptr;
+}
+
+template< typename T >
+void Block< T >::copy_slots(const Block &other)
+{
+	if (!other.slots)
+		return;
+
+	slots = std::allocator< Element >().allocate(capacity);
+	if constexpr (std::is_trivially_copyable_v< T >)
+	{
+		std::memcpy(static_cast< void * >(slots),
+					static_cast< const void * >(other.slots),
+					other.used_slots * sizeof(Element));
+		auto rebase = [this, &other](auto *pointer)
+		{
+			using Pointer = decltype(pointer);
+			if (!pointer)
+				return pointer;
+			const char *base = reinterpret_cast< const char * >(other.slots);
+			ptrdiff_t offset = reinterpret_cast< const char * >(pointer) - base;
+			return reinterpret_cast< Pointer >(reinterpret_cast< char * >(slots) + offset);
+		};
+		head_element = rebase(other.head_element);
+		tail_element = rebase(other.tail_element);
+		for (Element *current = head_element; current; current = current->next_element)
+		{
+			current->prev_element = rebase(current->prev_element);
+			current->next_element = rebase(current->next_element);
+		}
+		free_slots = rebase(other.free_slots);
+		for (FreeSlot *slot = free_slots; slot; slot = slot->next)
+			slot->next = rebase(slot->next);
+		used_slots = other.used_slots;
+		block_elements_counter = other.block_elements_counter;
+		block_tombstones_counter = other.block_tombstones_counter;
+	}
+	else
+	{
+		try
+		{
+			for (Element *current = other.head_element; current; current = current->next_element)
+			{
+				if (current->tombstone)
+					continue;
+				Element *copy = ::new (slots + used_slots) Element{ current->element_data, tail_element, nullptr };
+				++used_slots;
+				if (tail_element)
+					tail_element->next_element = copy;
+				else
+					head_element = copy;
+				tail_element = copy;
+			}
+		} catch (...)
+		{
+			destroy_slots();
+			head_element = tail_element = nullptr;
+			throw;
+		}
+		block_elements_counter = used_slots;
+	}
 }
 
 template< typename T >
 bool Block< T >::is_full() const
 {
-	return capacity == block_elements_counter;
+	return used_slots == capacity && !free_slots;
 }
 
 template< typename T >
@@ -105,34 +378,68 @@ bool Block< T >::is_empty() const noexcept
 }
 
 template< typename T >
-template< typename U >
-void Block< T >::insert_element_general(U &&value)
+size_t Block< T >::get_capacity() const noexcept
+{
+	return capacity;
+}
+
+template< typename T >
+size_t Block< T >::get_size() const noexcept
+{
+	return block_elements_counter;
+}
+
+template< typename T >
+size_t Block< T >::get_tombstones() const noexcept
+{
+	return block_tombstones_counter;
+}
+
+template< typename T >
+const typename Block< T >::Element *Block< T >::prefetch_target(const Element *element) const noexcept
+{
+	size_t index = static_cast< size_t >(element - slots) + prefetch_distance;
+	if (index < used_slots)
+		return slots + index;
+	if (!next_block || index - used_slots >= next_block->used_slots)
+		return nullptr;
+	return next_block->slots + (index - used_slots);
+}
+
+template< typename T >
+template< typename... Args >
+void Block< T >::insert_element_general(Args &&...args)
 {
-	auto *new_element = new Element{ std::forward< U >(value), nullptr, nullptr };
-	if (!new_element)
+	if (is_full())
 	{
-		throw std::bad_alloc();
+		throw std::logic_error("Block elements counter exceeded capacity");
+	}
+	void *slot = acquire_slot();
+	Element *new_element;
+	try
+	{
+		new_element = ::new (slot) Element(std::in_place, std::forward< Args >(args)...);
+	} catch (...)
+	{
+		return_slot(slot);
+		throw;
 	}
 	if (!head_element)
 	{
-		head_element = tail_element = new_element;
+		tail_element = new_element;
+		store_release(head_element, new_element);
 	}
 	else
 	{
-		tail_element->next_element = new_element;
 		new_element->prev_element = tail_element;
+		store_release(tail_element->next_element, new_element);
 		tail_element = new_element;
 	}
 	++block_elements_counter;
-
-	if (block_elements_counter > capacity)
-	{
-		throw std::logic_error("Block elements counter exceeded capacity");
-	}
 }
 
 template< typename T >
-void Block< T >::remove_element(Element *element)
+void Block< T >::unlink_element(Element *element)
 {
 	if (!element)
 	{
@@ -144,34 +451,63 @@ void Block< T >::remove_element(Element *element)
 	}
 
 	if (element == head_element)
-		head_element = element->next_element;
+		store_release(head_element, element->next_element);
 	if (element == tail_element)
 		tail_element = element->prev_element;
 	if (element->prev_element)
-		element->prev_element->next_element = element->next_element;
+		store_release(element->prev_element->next_element, element->next_element);
 	if (element->next_element)
 		element->next_element->prev_element = element->prev_element;
 
-	delete element;
+	if (element->tombstone)
+		--block_tombstones_counter;
 	--block_elements_counter;
 }
 
 template< typename T >
-void Block< T >::clear()
+void Block< T >::remove_element(Element *element)
 {
-	if (this->is_empty())
+	unlink_element(element);
+	release_slot(element);
+}
+
+template< typename T >
+void Block< T >::mark_erased(Element *element)
+{
+	if (!element)
 	{
-		return;
+		throw std::invalid_argument("Cannot mark a null element");
 	}
+	if (element->tombstone)
+		return;
+	store_release(element->tombstone, true);
+	++block_tombstones_counter;
+}
+
+template< typename T >
+template< typename Dispose >
+size_t Block< T >::compact(Dispose &&dispose)
+{
+	size_t removed = 0;
 	Element *current = head_element;
-	while (current)
+	while (current && block_tombstones_counter > 0)
 	{
 		Element *next = current->next_element;
-		delete current;
+		if (current->tombstone)
+		{
+			unlink_element(current);
+			dispose(current);
+			++removed;
+		}
 		current = next;
 	}
-	head_element = tail_element = nullptr;
-	block_elements_counter = 0;
+	return removed;
+}
+
+template< typename T >
+bool Block< T >::has_tombstones() const noexcept
+{
+	return block_tombstones_counter != 0;
 }
 
 template< typename T >
@@ -185,12 +521,10 @@ class LinkedStack
 	Block< T > *top() const;
 	void void_pop();
 	void get_rid_of(Block< T > *block);
+	void splice(LinkedStack< T > &other) noexcept;
 	void clear();
 	[[nodiscard]] bool empty() const;
 
-  private:
-	LinkedStack< T > &operator=(const LinkedStack< T > &other);
-	LinkedStack< T > &operator=(LinkedStack< T > &&other) noexcept;
 	struct Node
 	{
 		Block< T > *block;
@@ -200,6 +534,10 @@ class LinkedStack
 		explicit Node(Block< T > *b);
 	};
 
+  private:
+	LinkedStack< T > &operator=(const LinkedStack< T > &other);
+	LinkedStack< T > &operator=(LinkedStack< T > &&other) noexcept;
+
 	Node *head;
 	Node *tail;
 	size_t stack_size;
@@ -256,6 +594,7 @@ void LinkedStack< T >::clear()
 	{
 		Node *tmp = head;
 		head = head->next;
+		tmp->block->stack_node = nullptr;
 		delete tmp;
 	}
 	head = nullptr;
@@ -273,6 +612,7 @@ template< typename T >
 void LinkedStack< T >::push(Block< T > *block)
 {
 	Node *new_node = new Node(block);
+	block->stack_node = new_node;
 	if (this->empty())
 	{
 		head = tail = new_node;
@@ -302,6 +642,7 @@ void LinkedStack< T >::void_pop()
 		throw std::out_of_range("Stack is empty. Cannot pop.");
 	}
 	Node *temp = head;
+	temp->block->stack_node = nullptr;
 	if (head == tail)
 	{
 		head = tail = nullptr;
@@ -322,12 +663,7 @@ void LinkedStack< T >::get_rid_of(Block< T > *block)
 	{
 		throw std::invalid_argument("Block cannot be null");
 	}
-	Node *current = head;
-	while (current && current->block != block)
-	{
-		current = current->next;
-	}
-
+	Node *current = block->stack_node;
 	if (!current)
 		return;
 
@@ -339,16 +675,125 @@ void LinkedStack< T >::get_rid_of(Block< T > *block)
 		current->prev->next = current->next;
 	if (current->next)
 		current->next->prev = current->prev;
+	block->stack_node = nullptr;
 	delete current;
 	--stack_size;
 }
 
+template< typename T >
+void LinkedStack< T >::splice(LinkedStack< T > &other) noexcept
+{
+	if (this == &other || other.empty())
+		return;
+	if (this->empty())
+	{
+		head = other.head;
+	}
+	else
+	{
+		tail->next = other.head;
+		other.head->prev = tail;
+	}
+	tail = other.tail;
+	stack_size += other.stack_size;
+
+	other.head = nullptr;
+	other.tail = nullptr;
+	other.stack_size = 0;
+}
+
 template< typename T >
 bool LinkedStack< T >::empty() const
 {
 	return stack_size == 0;
 }
 
+class EpochDomain
+{
+  public:
+	static constexpr size_t MAX_READERS = 64;
+
+	class Guard
+	{
+	  public:
+		explicit Guard(EpochDomain &domain);
+		Guard(const Guard &other) = delete;
+		Guard &operator=(const Guard &other) = delete;
+		~Guard();
+
+	  private:
+		EpochDomain &domain;
+		size_t slot;
+	};
+
+	EpochDomain();
+	[[nodiscard]] uint64_t current() const noexcept;
+	uint64_t advance() noexcept;
+
+  private:
+	struct alignas(64) ReaderSlot
+	{
+		std::atomic< uint64_t > epoch;
+	};
+
+	size_t pin();
+	void unpin(size_t slot) noexcept;
+
+	ReaderSlot readers[MAX_READERS];
+	alignas(64) std::atomic< uint64_t > global_epoch;
+};
+
+inline EpochDomain::Guard::Guard(EpochDomain &domain) : domain(domain), slot(domain.pin()) {}
+
+inline EpochDomain::Guard::~Guard()
+{
+	domain.unpin(slot);
+}
+
+inline EpochDomain::EpochDomain() : global_epoch(1)
+{
+	for (ReaderSlot &reader : readers)
+		reader.epoch.store(0, std::memory_order_relaxed);
+}
+
+inline uint64_t EpochDomain::current() const noexcept
+{
+	return global_epoch.load(std::memory_order_relaxed);
+}
+
+inline uint64_t EpochDomain::advance() noexcept
+{
+	uint64_t oldest_visible = global_epoch.fetch_add(1, std::memory_order_seq_cst) + 1;
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	for (const ReaderSlot &reader : readers)
+	{
+		uint64_t epoch = reader.epoch.load(std::memory_order_acquire);
+		if (epoch != 0 && epoch < oldest_visible)
+			oldest_visible = epoch;
+	}
+	return oldest_visible;
+}
+
+inline size_t EpochDomain::pin()
+{
+	uint64_t epoch = global_epoch.load(std::memory_order_acquire);
+	for (size_t i = 0; i < MAX_READERS; ++i)
+	{
+		uint64_t expected = 0;
+		if (readers[i].epoch.compare_exchange_strong(expected, epoch, std::memory_order_seq_cst))
+		{
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			return i;
+		}
+	}
+	throw std::overflow_error("Too many concurrent readers");
+}
+
+inline void EpochDomain::unpin(size_t slot) noexcept
+{
+	readers[slot].epoch.store(0, std::memory_order_release);
+}
+
 template< typename T >
 class BucketStorageConstIterator;
 
@@ -396,7 +841,7 @@ class BucketStorageIterator
 	operator BucketStorageConstIterator< T >() const;
 
 	Block< T > *current_block;
-	typename Block< T >::Element *current_element;
+	mutable typename Block< T >::Element *current_element;
 
 	int compare_position(const BucketStorageIterator &other) const;
 };
@@ -412,7 +857,6 @@ typename BucketStorageIterator< T >::reference BucketStorageIterator< T >::opera
 {
 	if (!current_block->next_block && !current_element)
 		throw std::out_of_range("Attempted to dereference end() iterator.");
-
 	return current_element->element_data;
 }
 
@@ -421,7 +865,6 @@ typename BucketStorageIterator< T >::pointer BucketStorageIterator< T >::operato
 {
 	if (!current_block->next_block && !current_element)
 		throw std::out_of_range("Attempted to dereference end() iterator.");
-
 	return &(current_element->element_data);
 }
 
@@ -432,18 +875,28 @@ BucketStorageIterator< T > &BucketStorageIterator< T >::operator++()
 	{
 		throw std::out_of_range("Iterator cannot be incremented.");
 	}
-	if (current_element && current_element->next_element)
+	do
 	{
-		current_element = current_element->next_element;
-	}
-	else if (current_block && current_block->next_block)
-	{
-		current_block = current_block->next_block;
-		current_element = current_block->head_element;
-	}
-	else
+		if (current_element->next_element)
+		{
+			current_element = current_element->next_element;
+		}
+		else if (current_block->next_block)
+		{
+			current_block = current_block->next_block;
+			current_element = current_block->head_element;
+			if (current_block->next_block)
+				prefetch_for_read(current_block->next_block);
+		}
+		else
+		{
+			current_element = nullptr;
+		}
+	} while (current_element && current_element->tombstone);
+	if (current_element && current_block->prefetch_distance)
 	{
-		current_element = nullptr;
+		if (const void *ahead = current_block->prefetch_target(current_element))
+			prefetch_for_read(ahead);
 	}
 	return *this;
 }
@@ -463,24 +916,27 @@ BucketStorageIterator< T > &BucketStorageIterator< T >::operator--()
 	{
 		throw std::out_of_range("Iterator cannot be decremented");
 	}
-	if (current_block && !current_block->next_block && !current_element)
-	{
-		current_element = current_block->tail_element;
-	}
-	else if (current_element && current_element->prev_element)
-	{
-		current_element = current_element->prev_element;
-	}
-	else if (current_block->prev_block)
-	{
-		current_block = current_block->prev_block;
-		current_element = current_block->tail_element;
-	}
-	else
+	do
 	{
-		current_block = nullptr;
-		current_element = nullptr;
-	}
+		if (!current_block->next_block && !current_element)
+		{
+			current_element = current_block->tail_element;
+		}
+		else if (current_element && current_element->prev_element)
+		{
+			current_element = current_element->prev_element;
+		}
+		else if (current_block->prev_block)
+		{
+			current_block = current_block->prev_block;
+			current_element = current_block->tail_element;
+		}
+		else
+		{
+			current_block = nullptr;
+			current_element = nullptr;
+		}
+	} while (current_element && current_element->tombstone);
 	return *this;
 }
 
@@ -685,6 +1141,9 @@ class BucketStorage
 
 	explicit BucketStorage(size_t block_capacity);
 
+	// New blocks grow geometrically with size() from block_capacity up to max_block_capacity.
+	BucketStorage(size_t block_capacity, size_t max_block_capacity);
+
 	BucketStorage(const BucketStorage &other);
 
 	BucketStorage(BucketStorage &&other) noexcept;
@@ -699,22 +1158,66 @@ class BucketStorage
 
 	iterator insert(value_type &&value);
 
-	iterator erase(const_iterator it);
+	template< typename... Args >
+	iterator emplace(Args &&...args);
 
-	[[nodiscard]] bool empty() const noexcept;
+	iterator insert(const_iterator hint, const value_type &value);
 
-	[[nodiscard]] size_t size() const noexcept;
+	iterator insert(const_iterator hint, value_type &&value);
 
-	size_type capacity() const noexcept;
+	template< typename... Args >
+	iterator emplace_hint(const_iterator hint, Args &&...args);
 
-	void shrink_to_fit();
+	// Keeps elements of one affinity group together in blocks that plain inserts never use. Groups are keyed by
+	// affinity % AFFINITY_SLOTS, so keys that collide modulo AFFINITY_SLOTS share their blocks.
+	iterator insert_with_affinity(size_t affinity, const value_type &value);
 
-	void clear_blocks_and_elements_inside();
+	iterator insert_with_affinity(size_t affinity, value_type &&value);
 
-	void clear();
+	iterator erase(const_iterator it);
+
+	iterator mark_erased(const_iterator it);
+
+	void compact();
+
+	struct DefragmentProgress
+	{
+		size_t moved;
+		size_t blocks_freed;
+		bool done;
+	};
+
+	// Moves elements out of blocks at most half full into free slots nearer the head, spending at most budget
+	// units of work (one per element moved or block visited). Iterators to moved elements are invalidated.
+	DefragmentProgress defragment_step(size_t budget);
+
+	template< typename Rep, typename Period >
+	DefragmentProgress defragment_for(std::chrono::duration< Rep, Period > time_budget);
+
+	[[nodiscard]] bool empty() const noexcept;
+
+	[[nodiscard]] size_t size() const noexcept;
+
+	size_type capacity() const noexcept;
+
+	void shrink_to_fit();
+
+	void clear_blocks_and_elements_inside();
+
+	void clear();
 
 	void swap(BucketStorage &other) noexcept;
 
+	void merge(BucketStorage &&other);
+
+	std::vector< BucketStorage > split(size_t n_parts);
+
+	// Moves the live values into one buffer, sorts a chunk of it per worker on up to threads workers (0 picks one per
+	// core), then merges the chunks pairwise back into the same slots in iteration order. Must not run concurrently
+	// with readers; if comp throws, live elements are left valid but with unspecified values.
+	template< typename Compare = std::less< T > >
+	void sort(Compare comp = Compare(), bool stable = false, size_t threads = 0);
+
 	iterator begin() noexcept;
 
 	iterator end() noexcept;
@@ -729,19 +1232,94 @@ class BucketStorage
 
 	iterator get_to_distance(iterator it, const difference_type distance);
 
+	// Iterators prefetch the slot this many elements ahead, crossing into the next block near the end of a block.
+	// 0 turns look-ahead off; the header of the next block is prefetched on entering a block either way.
+	void set_prefetch_distance(size_t distance) noexcept;
+
+	[[nodiscard]] size_t get_prefetch_distance() const noexcept;
+
+	// Readers may run concurrent_for_each while a single writer calls insert, erase, mark_erased, compact,
+	// defragment_step, shrink_to_fit, merge or split. Under a domain, defragment_step and shrink_to_fit copy elements
+	// instead of moving them and throw std::logic_error for non-copyable T; merge and split wait for the readers of
+	// the storage that gives up its blocks. A scan may miss or repeat elements that are inserted or moved under it.
+	void enable_deferred_reclamation();
+
+	template< typename Visitor >
+	void concurrent_for_each(Visitor &&visitor) const;
+
+	void collect_retired();
+
   private:
+	static constexpr size_t RECLAIM_THRESHOLD = 64;
+	static constexpr size_t HINT_SEARCH_DISTANCE = 2;
+	static constexpr size_t AFFINITY_SLOTS = 64;
+	static constexpr size_t GROWTH_DIVISOR = 8;
+	static constexpr size_t DEFRAGMENT_SLICE = 64;
+	static constexpr size_t PARALLEL_SORT_THRESHOLD = 1 << 14;
+	static constexpr size_t DEFAULT_PREFETCH_DISTANCE = 32;
+
+	struct RetiredNode
+	{
+		Block< T > *block;
+		typename Block< T >::Element *element;
+		uint64_t epoch;
+		RetiredNode *next;
+	};
+
 	Block< T > *retrieve_block();
 
+	Block< T > *create_block();
+
+	size_t next_block_capacity() const noexcept;
+
+	Block< T > *retrieve_block_near(Block< T > *hint_block);
+
+	Block< T > *retrieve_affinity_block(size_t affinity);
+
+	template< typename... Args >
+	iterator emplace_into(Block< T > *block, Args &&...args);
+
 	void remove_block(Block< T > *block);
 
 	void copy_storage_elements(const BucketStorage &other);
 
+	void relocate_compacted(BucketStorage &target);
+
+	void append_block(Block< T > *block);
+
+	static iterator skip_erased(iterator it);
+
+	static bool is_sparse(const Block< T > *block) noexcept;
+
+	static bool is_open(const Block< T > *block) noexcept;
+
+	void offer_room(Block< T > *block);
+
+	void release_element(Block< T > *block, typename Block< T >::Element *element);
+
+	void retire(Block< T > *block, typename Block< T >::Element *element);
+
+	void free_retired(uint64_t oldest_visible_epoch);
+
+	void synchronize_readers();
+
 	Block< T > *head_block;
 	Block< T > *tail_block;
 	size_t block_capacity;
+	size_t max_block_capacity;
+	size_t total_capacity;
 	size_t elements_count;
 	size_t blocks_count;
+	size_t tombstones_count;
 	LinkedStack< T > *available_blocks;
+	Block< T > **affinity_blocks;
+	EpochDomain *reclamation_domain;
+	RetiredNode *retired_head;
+	RetiredNode *retired_tail;
+	size_t retired_count;
+	Block< T > *defrag_target;
+	Block< T > *defrag_source;
+	size_t prefetch_distance;
 };
 
 template< typename T >
@@ -750,30 +1328,59 @@ BucketStorage< T >::BucketStorage() : BucketStorage(64)
 }
 
 template< typename T >
-BucketStorage< T >::BucketStorage(size_t block_capacity) :
-	block_capacity(block_capacity), elements_count(0), blocks_count(0), head_block(nullptr), tail_block(nullptr),
-	available_blocks(new LinkedStack< T >())
+BucketStorage< T >::BucketStorage(size_t block_capacity) : BucketStorage(block_capacity, block_capacity)
 {
 }
 
+template< typename T >
+BucketStorage< T >::BucketStorage(size_t block_capacity, size_t max_block_capacity) :
+	head_block(nullptr), tail_block(nullptr), block_capacity(block_capacity), max_block_capacity(max_block_capacity),
+	total_capacity(0), elements_count(0), blocks_count(0), tombstones_count(0), available_blocks(nullptr),
+	affinity_blocks(nullptr), reclamation_domain(nullptr), retired_head(nullptr), retired_tail(nullptr),
+	retired_count(0), defrag_target(nullptr), defrag_source(nullptr), prefetch_distance(DEFAULT_PREFETCH_DISTANCE)
+{
+	if (max_block_capacity < block_capacity)
+	{
+		throw std::invalid_argument("Maximum block capacity must not be less than block capacity");
+	}
+	available_blocks = new LinkedStack< T >();
+}
+
 template< typename T >
 BucketStorage< T >::BucketStorage(const BucketStorage &other) :
-	block_capacity(other.block_capacity), elements_count(other.elements_count), blocks_count(other.blocks_count),
-	head_block(nullptr), tail_block(nullptr), available_blocks(new LinkedStack< T >())
+	head_block(nullptr), tail_block(nullptr), block_capacity(other.block_capacity),
+	max_block_capacity(other.max_block_capacity), total_capacity(0), elements_count(0), blocks_count(0),
+	tombstones_count(0), available_blocks(new LinkedStack< T >()), affinity_blocks(nullptr),
+	reclamation_domain(nullptr), retired_head(nullptr), retired_tail(nullptr), retired_count(0), defrag_target(nullptr),
+	defrag_source(nullptr), prefetch_distance(other.prefetch_distance)
 {
 	this->copy_storage_elements(other);
 }
 
 template< typename T >
 BucketStorage< T >::BucketStorage(BucketStorage &&other) noexcept :
-	block_capacity(other.block_capacity), elements_count(other.elements_count), blocks_count(other.blocks_count),
-	head_block(std::move(other.head_block)), tail_block(std::move(other.tail_block)), available_blocks(other.available_blocks)
+	head_block(std::move(other.head_block)), tail_block(std::move(other.tail_block)),
+	block_capacity(other.block_capacity), max_block_capacity(other.max_block_capacity),
+	total_capacity(other.total_capacity), elements_count(other.elements_count), blocks_count(other.blocks_count),
+	tombstones_count(other.tombstones_count), available_blocks(other.available_blocks),
+	affinity_blocks(other.affinity_blocks), reclamation_domain(other.reclamation_domain),
+	retired_head(other.retired_head), retired_tail(other.retired_tail), retired_count(other.retired_count),
+	defrag_target(other.defrag_target), defrag_source(other.defrag_source), prefetch_distance(other.prefetch_distance)
 {
 	other.head_block = nullptr;
 	other.tail_block = nullptr;
 	other.elements_count = 0;
 	other.blocks_count = 0;
+	other.total_capacity = 0;
+	other.tombstones_count = 0;
 	other.available_blocks = nullptr;
+	other.affinity_blocks = nullptr;
+	other.reclamation_domain = nullptr;
+	other.retired_head = nullptr;
+	other.retired_tail = nullptr;
+	other.retired_count = 0;
+	other.defrag_target = nullptr;
+	other.defrag_source = nullptr;
 }
 
 template< typename T >
@@ -781,6 +1388,8 @@ BucketStorage< T >::~BucketStorage()
 {
 	clear();
 	delete available_blocks;
+	delete[] affinity_blocks;
+	delete reclamation_domain;
 }
 
 template< typename T >
@@ -790,6 +1399,8 @@ BucketStorage< T > &BucketStorage< T >::operator=(const BucketStorage &other)
 	{
 		clear();
 		block_capacity = other.block_capacity;
+		max_block_capacity = other.max_block_capacity;
+		prefetch_distance = other.prefetch_distance;
 		this->copy_storage_elements(other);
 	}
 	return *this;
@@ -809,27 +1420,51 @@ BucketStorage< T > &BucketStorage< T >::operator=(BucketStorage &&other) noexcep
 template< typename T >
 typename BucketStorage< T >::iterator BucketStorage< T >::insert(const value_type &value)
 {
-	Block< T > *current_block = retrieve_block();
-	current_block->insert_element_general(value);
-	++elements_count;
-	if (current_block->is_full())
-	{
-		available_blocks->void_pop();
-	}
-	return iterator(current_block, current_block->tail_element);
+	return emplace_into(retrieve_block(), value);
 }
 
 template< typename T >
 typename BucketStorage< T >::iterator BucketStorage< T >::insert(value_type &&value)
 {
-	Block< T > *current_block = retrieve_block();
-	current_block->insert_element_general(std::move(value));
-	++elements_count;
-	if (current_block->is_full())
-	{
-		available_blocks->void_pop();
-	}
-	return iterator(current_block, current_block->tail_element);
+	return emplace_into(retrieve_block(), std::move(value));
+}
+
+template< typename T >
+template< typename... Args >
+typename BucketStorage< T >::iterator BucketStorage< T >::emplace(Args &&...args)
+{
+	return emplace_into(retrieve_block(), std::forward< Args >(args)...);
+}
+
+template< typename T >
+typename BucketStorage< T >::iterator BucketStorage< T >::insert(const_iterator hint, const value_type &value)
+{
+	return emplace_into(retrieve_block_near(hint.current_block), value);
+}
+
+template< typename T >
+typename BucketStorage< T >::iterator BucketStorage< T >::insert(const_iterator hint, value_type &&value)
+{
+	return emplace_into(retrieve_block_near(hint.current_block), std::move(value));
+}
+
+template< typename T >
+template< typename... Args >
+typename BucketStorage< T >::iterator BucketStorage< T >::emplace_hint(const_iterator hint, Args &&...args)
+{
+	return emplace_into(retrieve_block_near(hint.current_block), std::forward< Args >(args)...);
+}
+
+template< typename T >
+typename BucketStorage< T >::iterator BucketStorage< T >::insert_with_affinity(size_t affinity, const value_type &value)
+{
+	return emplace_into(retrieve_affinity_block(affinity), value);
+}
+
+template< typename T >
+typename BucketStorage< T >::iterator BucketStorage< T >::insert_with_affinity(size_t affinity, value_type &&value)
+{
+	return emplace_into(retrieve_affinity_block(affinity), std::move(value));
 }
 
 template< typename T >
@@ -847,29 +1482,156 @@ typename BucketStorage< T >::iterator BucketStorage< T >::erase(const_iterator i
 
 	auto safe_remove = [this, current_block, current_element]()
 	{
-		current_block->remove_element(current_element);
-		--elements_count;
+		if (current_element->tombstone)
+			--tombstones_count;
+		else
+			--elements_count;
+		current_block->unlink_element(current_element);
+		release_element(current_block, current_element);
 		if (current_block->is_empty())
 		{
 			available_blocks->get_rid_of(current_block);
 			remove_block(current_block);
 		}
+		else
+		{
+			offer_room(current_block);
+		}
 	};
 
-	if (!current_block->prev_block && !current_block->next_block && !current_element->next_element && !current_element->prev_element)
+	Block< T > *next_block = current_block->next_block;
+	safe_remove();
+	if (next_element)
+		return skip_erased(iterator(current_block, next_element));
+	if (next_block)
+		return skip_erased(iterator(next_block, next_block->head_element));
+	return end();
+}
+
+template< typename T >
+typename BucketStorage< T >::iterator BucketStorage< T >::mark_erased(const_iterator it)
+{
+	Block< T > *current_block = it.current_block;
+	typename Block< T >::Element *current_element = it.current_element;
+
+	if (!current_block || !current_element)
 	{
-		safe_remove();
-		return end();
+		return iterator(nullptr, nullptr);
 	}
-	else if (!current_element->next_element && current_block->next_block)
+
+	if (!current_element->tombstone)
 	{
-		Block< T > *next_block = it.current_block->next_block;
-		safe_remove();
-		return iterator(next_block, next_block->head_element);
+		current_block->mark_erased(current_element);
+		--elements_count;
+		++tombstones_count;
 	}
+	return ++iterator(current_block, current_element);
+}
 
-	safe_remove();
-	return iterator(current_block, next_element);
+template< typename T >
+void BucketStorage< T >::compact()
+{
+	Block< T > *current_block = head_block;
+	while (current_block && tombstones_count > 0)
+	{
+		Block< T > *next_block = current_block->next_block;
+		if (current_block->has_tombstones())
+		{
+			tombstones_count -= current_block->compact([this, current_block](typename Block< T >::Element *element)
+														{ release_element(current_block, element); });
+			if (current_block->is_empty())
+			{
+				available_blocks->get_rid_of(current_block);
+				remove_block(current_block);
+			}
+			else
+			{
+				offer_room(current_block);
+			}
+		}
+		current_block = next_block;
+	}
+}
+
+template< typename T >
+typename BucketStorage< T >::DefragmentProgress BucketStorage< T >::defragment_step(size_t budget)
+{
+	DefragmentProgress progress = { 0, 0, false };
+	if (!defrag_target)
+	{
+		defrag_target = head_block;
+		defrag_source = tail_block;
+	}
+	while (budget > 0)
+	{
+		if (!defrag_target || !defrag_source || defrag_target == defrag_source)
+		{
+			defrag_target = defrag_source = nullptr;
+			progress.done = true;
+			break;
+		}
+		if (!is_open(defrag_target))
+		{
+			defrag_target = defrag_target->next_block;
+			--budget;
+			continue;
+		}
+		if (!is_sparse(defrag_source))
+		{
+			defrag_source = defrag_source->prev_block;
+			--budget;
+			continue;
+		}
+
+		typename Block< T >::Element *element = defrag_source->head_element;
+		if (element->tombstone)
+		{
+			--tombstones_count;
+		}
+		else
+		{
+			// A concurrent reader may still be inside the source element, so under a domain it is copied and
+			// retired instead of being moved from.
+			if (reclamation_domain)
+			{
+				if constexpr (std::is_copy_constructible_v< T >)
+					defrag_target->insert_element_general(std::as_const(element->element_data));
+				else
+					throw std::logic_error("Defragmenting under deferred reclamation requires copyable elements");
+			}
+			else
+				defrag_target->insert_element_general(std::move(element->element_data));
+			++progress.moved;
+		}
+		defrag_source->unlink_element(element);
+		release_element(defrag_source, element);
+		--budget;
+
+		if (defrag_source->is_empty())
+		{
+			available_blocks->get_rid_of(defrag_source);
+			remove_block(defrag_source);
+			++progress.blocks_freed;
+		}
+	}
+	return progress;
+}
+
+template< typename T >
+template< typename Rep, typename Period >
+typename BucketStorage< T >::DefragmentProgress
+	BucketStorage< T >::defragment_for(std::chrono::duration< Rep, Period > time_budget)
+{
+	auto deadline = std::chrono::steady_clock::now() + time_budget;
+	DefragmentProgress progress = { 0, 0, false };
+	do
+	{
+		DefragmentProgress slice = defragment_step(DEFRAGMENT_SLICE);
+		progress.moved += slice.moved;
+		progress.blocks_freed += slice.blocks_freed;
+		progress.done = slice.done;
+	} while (!progress.done && std::chrono::steady_clock::now() < deadline);
+	return progress;
 }
 
 template< typename T >
@@ -887,47 +1649,185 @@ size_t BucketStorage< T >::size() const noexcept
 template< typename T >
 typename BucketStorage< T >::size_type BucketStorage< T >::capacity() const noexcept
 {
-	return block_capacity * blocks_count;
+	return total_capacity;
 }
 
 template< typename T >
 void BucketStorage< T >::shrink_to_fit()
 {
-	BucketStorage< T > new_storage(block_capacity);
-	while (!this->empty())
+	BucketStorage< T > new_storage(block_capacity, max_block_capacity);
+	new_storage.prefetch_distance = prefetch_distance;
+	if constexpr (is_trivially_relocatable_v< T >)
+	{
+		if (!reclamation_domain)
+		{
+			relocate_compacted(new_storage);
+			swap(new_storage);
+			return;
+		}
+	}
+	if (!reclamation_domain)
+	{
+		while (!this->empty())
+		{
+			new_storage.insert(std::move(*begin()));
+			erase(begin());
+		}
+		swap(new_storage);
+		return;
+	}
+
+	// Concurrent readers may still be inside the old blocks, so the live elements are copied, the new chain is
+	// published in one store and the old blocks are retired whole.
+	if constexpr (std::is_copy_constructible_v< T >)
 	{
-		new_storage.insert(std::move(*begin()));
-		erase(begin());
+		for (const T &value : std::as_const(*this))
+			new_storage.insert(value);
+		Block< T > *old_head = head_block;
+		tail_block = new_storage.tail_block;
+		store_release(head_block, new_storage.head_block);
+		new_storage.head_block = new_storage.tail_block = nullptr;
+		std::swap(elements_count, new_storage.elements_count);
+		std::swap(blocks_count, new_storage.blocks_count);
+		std::swap(total_capacity, new_storage.total_capacity);
+		std::swap(tombstones_count, new_storage.tombstones_count);
+		std::swap(available_blocks, new_storage.available_blocks);
+		std::swap(affinity_blocks, new_storage.affinity_blocks);
+		new_storage.available_blocks->clear();
+		defrag_target = defrag_source = nullptr;
+		while (old_head)
+		{
+			Block< T > *next = old_head->next_block;
+			retire(old_head, nullptr);
+			old_head = next;
+		}
 	}
-	swap(new_storage);
+	else
+		throw std::logic_error("Shrinking under deferred reclamation requires copyable elements");
+}
+
+template< typename T >
+void BucketStorage< T >::relocate_compacted(BucketStorage &target)
+{
+	using Element = typename Block< T >::Element;
+	// Each source block is drained and freed before the next one is read, so the allocator hands its memory straight
+	// back to the following destination blocks. Destination slots for a whole source block are reserved before any of
+	// its elements move, so nothing below can throw while an element has two owners.
+	size_t room = 0;
+	Block< T > *destination = nullptr;
+	try
+	{
+		while (Block< T > *block = head_block)
+		{
+			size_t live = block->get_size() - block->get_tombstones();
+			while (room < live)
+			{
+				auto *new_block = new Block< T >(target.next_block_capacity());
+				try
+				{
+					new_block->reserve_slots();
+				} catch (...)
+				{
+					delete new_block;
+					throw;
+				}
+				target.append_block(new_block);
+				room += new_block->get_capacity();
+				if (!destination)
+					destination = new_block;
+			}
+
+			for (Element *current = block->head_element; current;)
+			{
+				if (current->tombstone)
+				{
+					current = current->next_element;
+					continue;
+				}
+				size_t block_room = destination->relocation_room();
+				size_t count = 1;
+				while (count < block_room && current[count - 1].next_element == current + count &&
+					   !current[count].tombstone)
+					++count;
+				Element *next = current[count - 1].next_element;
+				destination->relocate_run(current, count);
+				target.elements_count += count;
+				room -= count;
+				if (destination->relocation_room() == 0)
+					destination = destination->next_block;
+				current = next;
+			}
+			tombstones_count -= block->get_tombstones();
+			block->discard_relocated();
+			available_blocks->get_rid_of(block);
+			remove_block(block);
+		}
+	} catch (...)
+	{
+		// Hand the relocated prefix back so that *this still holds every element in its original order.
+		while (Block< T > *block = target.tail_block)
+		{
+			target.tail_block = block->prev_block;
+			block->prev_block = nullptr;
+			if (block->is_empty())
+			{
+				delete block;
+				continue;
+			}
+			block->next_block = head_block;
+			if (head_block)
+				head_block->prev_block = block;
+			else
+				tail_block = block;
+			head_block = block;
+			++blocks_count;
+			total_capacity += block->get_capacity();
+			if (!block->is_full())
+				available_blocks->push(block);
+		}
+		target.head_block = nullptr;
+		target.blocks_count = 0;
+		target.total_capacity = 0;
+		target.elements_count = 0;
+		throw;
+	}
+	if (destination)
+		target.available_blocks->push(destination);
+	clear();
 }
 
 template< typename T >
 void BucketStorage< T >::clear_blocks_and_elements_inside()
 {
+	if (available_blocks != nullptr)
+	{
+		available_blocks->clear();
+	}
 	Block< T > *current_block = head_block;
 	while (current_block)
 	{
 		Block< T > *next_block = current_block->next_block;
-		current_block->clear();
 		delete current_block;
 		current_block = next_block;
 	}
 	head_block = tail_block = nullptr;
+	defrag_target = defrag_source = nullptr;
 	elements_count = 0;
 	blocks_count = 0;
+	total_capacity = 0;
 }
 
 template< typename T >
 void BucketStorage< T >::clear()
 {
+	free_retired(UINT64_MAX);
 	clear_blocks_and_elements_inside();
-	if (available_blocks != nullptr)
-	{
-		available_blocks->clear();
-	}
+	delete[] affinity_blocks;
+	affinity_blocks = nullptr;
 	elements_count = 0;
 	blocks_count = 0;
+	total_capacity = 0;
+	tombstones_count = 0;
 	head_block = nullptr;
 	tail_block = nullptr;
 }
@@ -939,15 +1839,280 @@ void BucketStorage< T >::swap(BucketStorage &other) noexcept
 	swap(head_block, other.head_block);
 	swap(tail_block, other.tail_block);
 	swap(block_capacity, other.block_capacity);
+	swap(max_block_capacity, other.max_block_capacity);
+	swap(total_capacity, other.total_capacity);
 	swap(elements_count, other.elements_count);
 	swap(blocks_count, other.blocks_count);
+	swap(tombstones_count, other.tombstones_count);
 	swap(available_blocks, other.available_blocks);
+	swap(affinity_blocks, other.affinity_blocks);
+	swap(reclamation_domain, other.reclamation_domain);
+	swap(retired_head, other.retired_head);
+	swap(retired_tail, other.retired_tail);
+	swap(retired_count, other.retired_count);
+	swap(defrag_target, other.defrag_target);
+	swap(defrag_source, other.defrag_source);
+	swap(prefetch_distance, other.prefetch_distance);
+}
+
+template< typename T >
+void BucketStorage< T >::merge(BucketStorage &&other)
+{
+	if (this == &other || !other.head_block)
+		return;
+
+	// Readers of other only know its domain, so they must be gone before its blocks are handed to *this.
+	Block< T > *other_head = other.head_block;
+	store_release(other.head_block, static_cast< Block< T > * >(nullptr));
+	other.synchronize_readers();
+	for (Block< T > *block = other_head; block; block = block->next_block)
+	{
+		block->prefetch_distance = prefetch_distance;
+		if (block->affinity_slot != SIZE_MAX)
+		{
+			block->affinity_slot = SIZE_MAX;
+			if (!block->is_full())
+				other.available_blocks->push(block);
+		}
+	}
+	if (!head_block)
+	{
+		store_release(head_block, other_head);
+	}
+	else
+	{
+		other_head->prev_block = tail_block;
+		store_release(tail_block->next_block, other_head);
+	}
+	tail_block = other.tail_block;
+	available_blocks->splice(*other.available_blocks);
+	elements_count += other.elements_count;
+	blocks_count += other.blocks_count;
+	total_capacity += other.total_capacity;
+	tombstones_count += other.tombstones_count;
+
+	delete[] other.affinity_blocks;
+	other.affinity_blocks = nullptr;
+	other.tail_block = nullptr;
+	other.defrag_target = nullptr;
+	other.defrag_source = nullptr;
+	other.elements_count = 0;
+	other.blocks_count = 0;
+	other.total_capacity = 0;
+	other.tombstones_count = 0;
+}
+
+template< typename T >
+std::vector< BucketStorage< T > > BucketStorage< T >::split(size_t n_parts)
+{
+	if (n_parts == 0)
+	{
+		throw std::invalid_argument("Number of parts must be greater than 0");
+	}
+	std::vector< BucketStorage > parts;
+	parts.reserve(n_parts);
+	for (size_t i = 0; i < n_parts; ++i)
+	{
+		parts.emplace_back(block_capacity, max_block_capacity);
+		parts.back().prefetch_distance = prefetch_distance;
+	}
+
+	Block< T > *block = head_block;
+	store_release(head_block, static_cast< Block< T > * >(nullptr));
+	synchronize_readers();
+	available_blocks->clear();
+	size_t taken = 0;
+	while (block)
+	{
+		Block< T > *next_block = block->next_block;
+		size_t live = block->get_size() - block->get_tombstones();
+		BucketStorage &part = parts[elements_count ? std::min(taken * n_parts / elements_count, n_parts - 1) : 0];
+		block->prev_block = nullptr;
+		block->next_block = nullptr;
+		block->affinity_slot = SIZE_MAX;
+		part.append_block(block);
+		if (!block->is_full())
+			part.available_blocks->push(block);
+		part.elements_count += live;
+		part.tombstones_count += block->get_tombstones();
+		taken += live;
+		block = next_block;
+	}
+
+	delete[] affinity_blocks;
+	affinity_blocks = nullptr;
+	tail_block = nullptr;
+	defrag_target = nullptr;
+	defrag_source = nullptr;
+	elements_count = 0;
+	blocks_count = 0;
+	total_capacity = 0;
+	tombstones_count = 0;
+	return parts;
+}
+
+template< typename T >
+template< typename Compare >
+void BucketStorage< T >::sort(Compare comp, bool stable, size_t threads)
+{
+	size_t count = elements_count;
+	if (count < 2)
+		return;
+
+	if (threads == 0)
+		threads = count < PARALLEL_SORT_THRESHOLD ? 1 : std::max(std::thread::hardware_concurrency(), 1u);
+	auto parallel_for = [&comp, threads](size_t tasks, auto &&task)
+	{
+		size_t workers_count = std::min(threads, tasks);
+		std::atomic< size_t > next_task{ 0 };
+		std::vector< std::exception_ptr > errors(workers_count);
+		auto work = [&](size_t worker)
+		{
+			try
+			{
+				Compare worker_comp = comp;
+				for (size_t i; (i = next_task.fetch_add(1, std::memory_order_relaxed)) < tasks;)
+					task(i, worker_comp);
+			} catch (...)
+			{
+				errors[worker] = std::current_exception();
+				next_task.store(tasks, std::memory_order_relaxed);
+			}
+		};
+		std::vector< std::thread > workers;
+		workers.reserve(workers_count - 1);
+		for (size_t worker = 1; worker < workers_count; ++worker)
+		{
+			try
+			{
+				workers.emplace_back(work, worker);
+			} catch (...)
+			{
+				break;
+			}
+		}
+		work(0);
+		for (std::thread &worker : workers)
+			worker.join();
+		for (std::exception_ptr &error : errors)
+		{
+			if (error)
+				std::rethrow_exception(error);
+		}
+	};
+
+	// One chunk per worker. bounds[i] is the first value of chunk i both in the buffer and, through cursors[i], in
+	// iteration order of the slots.
+	size_t chunks = std::min(threads, count);
+	std::vector< size_t > bounds(chunks + 1);
+	for (size_t chunk = 0; chunk <= chunks; ++chunk)
+		bounds[chunk] = count * chunk / chunks;
+	std::vector< iterator > cursors;
+	cursors.reserve(chunks + 1);
+	std::vector< T > buffer;
+	buffer.reserve(count);
+	for (iterator it = begin(); buffer.size() < count; ++it)
+	{
+		if (buffer.size() == bounds[cursors.size()])
+			cursors.push_back(it);
+		buffer.push_back(std::move(*it));
+	}
+	cursors.push_back(end());
+
+	parallel_for(chunks,
+				 [&buffer, &bounds, stable](size_t chunk, Compare &chunk_comp)
+				 {
+					 auto first = buffer.begin() + static_cast< difference_type >(bounds[chunk]);
+					 auto last = buffer.begin() + static_cast< difference_type >(bounds[chunk + 1]);
+					 if (stable)
+						 std::stable_sort(first, last, std::ref(chunk_comp));
+					 else
+						 std::sort(first, last, std::ref(chunk_comp));
+				 });
+
+	// Sorted runs are merged pairwise, each pass moving them between the buffer and the slots, so no pass needs
+	// more memory than the buffer. On equal values the left run wins, which keeps the merge stable.
+	auto merge_runs = [](auto left, size_t left_count, auto right, size_t right_count, auto out, Compare &run_comp)
+	{
+		while (left_count && right_count)
+		{
+			if (run_comp(*right, *left))
+			{
+				*out = std::move(*right);
+				++right;
+				--right_count;
+			}
+			else
+			{
+				*out = std::move(*left);
+				++left;
+				--left_count;
+			}
+			++out;
+		}
+		for (; left_count; --left_count, ++left, ++out)
+			*out = std::move(*left);
+		for (; right_count; --right_count, ++right, ++out)
+			*out = std::move(*right);
+	};
+	std::vector< size_t > runs(chunks + 1);
+	std::iota(runs.begin(), runs.end(), size_t(0));
+	bool in_buffer = true;
+	while (runs.size() > 2)
+	{
+		size_t last = runs.size() - 1;
+		parallel_for((last + 1) / 2,
+					 [&](size_t pair, Compare &run_comp)
+					 {
+						 size_t low = runs[2 * pair];
+						 size_t middle = runs[std::min(2 * pair + 1, last)];
+						 size_t high = runs[std::min(2 * pair + 2, last)];
+						 size_t left_count = bounds[middle] - bounds[low];
+						 size_t right_count = bounds[high] - bounds[middle];
+						 if (in_buffer)
+							 merge_runs(buffer.data() + bounds[low],
+										left_count,
+										buffer.data() + bounds[middle],
+										right_count,
+										cursors[low],
+										run_comp);
+						 else
+							 merge_runs(cursors[low],
+										left_count,
+										cursors[middle],
+										right_count,
+										buffer.data() + bounds[low],
+										run_comp);
+					 });
+		std::vector< size_t > merged_runs;
+		for (size_t run = 0; run < last; run += 2)
+			merged_runs.push_back(runs[run]);
+		merged_runs.push_back(runs[last]);
+		runs = std::move(merged_runs);
+		in_buffer = !in_buffer;
+	}
+	if (in_buffer)
+	{
+		parallel_for(chunks,
+					 [&buffer, &bounds, &cursors](size_t chunk, Compare &)
+					 {
+						 iterator out = cursors[chunk];
+						 for (size_t i = bounds[chunk]; i < bounds[chunk + 1]; ++i, ++out)
+							 *out = std::move(buffer[i]);
+					 });
+	}
+}
+
+template< typename T, typename Compare = std::less< T > >
+void sort(BucketStorage< T > &storage, Compare comp = Compare(), bool stable = false)
+{
+	storage.sort(std::move(comp), stable);
 }
 
 template< typename T >
 typename BucketStorage< T >::iterator BucketStorage< T >::begin() noexcept
 {
-	return iterator(head_block, head_block ? head_block->head_element : nullptr);
+	return skip_erased(iterator(head_block, head_block ? head_block->head_element : nullptr));
 }
 
 template< typename T >
@@ -959,7 +2124,7 @@ typename BucketStorage< T >::iterator BucketStorage< T >::end() noexcept
 template< typename T >
 typename BucketStorage< T >::const_iterator BucketStorage< T >::begin() const noexcept
 {
-	return const_iterator(head_block, head_block ? head_block->head_element : nullptr);
+	return skip_erased(iterator(head_block, head_block ? head_block->head_element : nullptr));
 }
 
 template< typename T >
@@ -1003,27 +2168,108 @@ typename BucketStorage< T >::iterator BucketStorage< T >::get_to_distance(iterat
 template< typename T >
 Block< T > *BucketStorage< T >::retrieve_block()
 {
+	while (!available_blocks->empty() && available_blocks->top()->is_full())
+	{
+		available_blocks->void_pop();
+	}
 	if (!available_blocks->empty())
 	{
 		return available_blocks->top();
 	}
+	return create_block();
+}
 
-	auto *new_block = new Block< T >(block_capacity);
+template< typename T >
+Block< T > *BucketStorage< T >::create_block()
+{
+	auto *new_block = new Block< T >(next_block_capacity());
 	available_blocks->push(new_block);
-	++blocks_count;
+	append_block(new_block);
+	return new_block;
+}
+
+template< typename T >
+size_t BucketStorage< T >::next_block_capacity() const noexcept
+{
+	size_t cap = block_capacity;
+	while (cap < max_block_capacity && cap < elements_count / GROWTH_DIVISOR)
+	{
+		cap *= 2;
+	}
+	return cap < max_block_capacity ? cap : max_block_capacity;
+}
+
+template< typename T >
+Block< T > *BucketStorage< T >::retrieve_block_near(Block< T > *hint_block)
+{
+	if (!hint_block)
+		return retrieve_block();
+	if (is_open(hint_block))
+		return hint_block;
+
+	Block< T > *before = hint_block->prev_block;
+	Block< T > *after = hint_block->next_block;
+	for (size_t step = 0; step < HINT_SEARCH_DISTANCE && (before || after); ++step)
+	{
+		if (after && is_open(after))
+			return after;
+		if (before && is_open(before))
+			return before;
+		after = after ? after->next_block : nullptr;
+		before = before ? before->prev_block : nullptr;
+	}
+	return retrieve_block();
+}
+
+template< typename T >
+Block< T > *BucketStorage< T >::retrieve_affinity_block(size_t affinity)
+{
+	if (!affinity_blocks)
+	{
+		affinity_blocks = new Block< T > *[AFFINITY_SLOTS]();
+	}
+	size_t slot = affinity % AFFINITY_SLOTS;
+	Block< T > *&group_block = affinity_blocks[slot];
+	if (!group_block || group_block->is_full())
+	{
+		auto *new_block = new Block< T >(next_block_capacity());
+		new_block->affinity_slot = slot;
+		append_block(new_block);
+		group_block = new_block;
+	}
+	return group_block;
+}
+
+template< typename T >
+template< typename... Args >
+typename BucketStorage< T >::iterator BucketStorage< T >::emplace_into(Block< T > *block, Args &&...args)
+{
+	block->insert_element_general(std::forward< Args >(args)...);
+	++elements_count;
+	if (block->is_full() && available_blocks->top() == block)
+	{
+		available_blocks->void_pop();
+	}
+	return iterator(block, block->tail_element);
+}
 
+template< typename T >
+void BucketStorage< T >::append_block(Block< T > *block)
+{
+	++blocks_count;
+	total_capacity += block->get_capacity();
+	block->prefetch_distance = prefetch_distance;
 	if (!head_block)
 	{
-		head_block = tail_block = new_block;
+		tail_block = block;
+		store_release(head_block, block);
 	}
 	else
 	{
-		tail_block->next_block = new_block;
-		new_block->prev_block = tail_block;
-		tail_block = new_block;
+		block->prev_block = tail_block;
+		store_release(tail_block->next_block, block);
+		tail_block = block;
 	}
-
-	return new_block;
 }
 
 template< typename T >
@@ -1034,24 +2280,178 @@ void BucketStorage< T >::remove_block(Block< T > *block)
 		throw std::runtime_error("Attempted to remove a null block");
 	}
 	if (block == head_block)
-		head_block = block->next_block;
+		store_release(head_block, block->next_block);
 	if (block == tail_block)
 		tail_block = block->prev_block;
 	if (block->prev_block)
-		block->prev_block->next_block = block->next_block;
+		store_release(block->prev_block->next_block, block->next_block);
 	if (block->next_block)
 		block->next_block->prev_block = block->prev_block;
 	--blocks_count;
-	delete block;
+	total_capacity -= block->get_capacity();
+	if (block == defrag_target)
+		defrag_target = block->next_block;
+	if (block == defrag_source)
+		defrag_source = block->prev_block;
+	if (affinity_blocks && block->affinity_slot < AFFINITY_SLOTS && affinity_blocks[block->affinity_slot] == block)
+		affinity_blocks[block->affinity_slot] = nullptr;
+	if (reclamation_domain)
+		retire(block, nullptr);
+	else
+		delete block;
 }
 
 template< typename T >
 void BucketStorage< T >::copy_storage_elements(const BucketStorage &other)
 {
-	for (auto it = other.begin(); it != other.end(); ++it)
+	for (Block< T > *block = other.head_block; block; block = block->next_block)
+	{
+		auto *copied_block = new Block< T >(*block);
+		append_block(copied_block);
+		if (!copied_block->is_full())
+			available_blocks->push(copied_block);
+		elements_count += copied_block->get_size() - copied_block->get_tombstones();
+		tombstones_count += copied_block->get_tombstones();
+	}
+}
+
+template< typename T >
+typename BucketStorage< T >::iterator BucketStorage< T >::skip_erased(iterator it)
+{
+	if (it.current_element && it.current_element->tombstone)
+		++it;
+	return it;
+}
+
+template< typename T >
+bool BucketStorage< T >::is_open(const Block< T > *block) noexcept
+{
+	return !block->is_full() && block->affinity_slot == SIZE_MAX;
+}
+
+template< typename T >
+void BucketStorage< T >::offer_room(Block< T > *block)
+{
+	if (block->affinity_slot == SIZE_MAX)
+	{
+		if (!block->stack_node)
+			available_blocks->push(block);
+		return;
+	}
+	// A group block with a free slot takes the group's next insert once the current group block is full.
+	Block< T > *&group_block = affinity_blocks[block->affinity_slot];
+	if (!group_block || group_block->is_full())
+		group_block = block;
+}
+
+template< typename T >
+bool BucketStorage< T >::is_sparse(const Block< T > *block) noexcept
+{
+	return 2 * (block->get_size() - block->get_tombstones()) <= block->get_capacity();
+}
+
+template< typename T >
+void BucketStorage< T >::set_prefetch_distance(size_t distance) noexcept
+{
+	prefetch_distance = distance;
+	for (Block< T > *block = head_block; block; block = block->next_block)
+		block->prefetch_distance = distance;
+}
+
+template< typename T >
+size_t BucketStorage< T >::get_prefetch_distance() const noexcept
+{
+	return prefetch_distance;
+}
+
+template< typename T >
+void BucketStorage< T >::enable_deferred_reclamation()
+{
+	if (reclamation_domain)
+		return;
+	reclamation_domain = new EpochDomain();
+}
+
+template< typename T >
+template< typename Visitor >
+void BucketStorage< T >::concurrent_for_each(Visitor &&visitor) const
+{
+	if (!reclamation_domain)
+	{
+		throw std::logic_error("Deferred reclamation is not enabled");
+	}
+	EpochDomain::Guard guard(*reclamation_domain);
+	for (Block< T > *block = load_acquire(head_block); block; block = load_acquire(block->next_block))
+	{
+		for (auto *element = load_acquire(block->head_element); element; element = load_acquire(element->next_element))
+		{
+			if (!load_acquire(element->tombstone))
+				visitor(static_cast< const T & >(element->element_data));
+		}
+	}
+}
+
+template< typename T >
+void BucketStorage< T >::collect_retired()
+{
+	if (reclamation_domain && retired_head)
+		free_retired(reclamation_domain->advance());
+}
+
+template< typename T >
+void BucketStorage< T >::release_element(Block< T > *block, typename Block< T >::Element *element)
+{
+	if (reclamation_domain)
+		retire(block, element);
+	else
+		block->release_slot(element);
+}
+
+template< typename T >
+void BucketStorage< T >::retire(Block< T > *block, typename Block< T >::Element *element)
+{
+	auto *node = new RetiredNode{ block, element, reclamation_domain->current(), nullptr };
+	if (!retired_tail)
+	{
+		retired_head = retired_tail = node;
+	}
+	else
+	{
+		retired_tail->next = node;
+		retired_tail = node;
+	}
+	if (++retired_count % RECLAIM_THRESHOLD == 0)
+		collect_retired();
+}
+
+template< typename T >
+void BucketStorage< T >::free_retired(uint64_t oldest_visible_epoch)
+{
+	while (retired_head && retired_head->epoch < oldest_visible_epoch)
+	{
+		RetiredNode *node = retired_head;
+		retired_head = node->next;
+		if (node->element)
+			node->block->release_slot(node->element);
+		else
+			delete node->block;
+		delete node;
+		--retired_count;
+	}
+	if (!retired_head)
+		retired_tail = nullptr;
+}
+
+template< typename T >
+void BucketStorage< T >::synchronize_readers()
+{
+	if (reclamation_domain)
 	{
-		insert(*it);
+		uint64_t epoch = reclamation_domain->current();
+		while (reclamation_domain->advance() <= epoch)
+			std::this_thread::yield();
 	}
+	free_retired(UINT64_MAX);
 }
 
 #endif /* BUCKET_STORAGE_HPP */
@@ -1,6 +1,7 @@
 #ifndef HELPERS_HPP
 #define HELPERS_HPP
 
+#include "allocation_counter.hpp"
 #include "bucket_storage.hpp"
 
 #include <ostream>
@@ -0,0 +1,488 @@
+#ifndef INPLACE_BUCKET_STORAGE_HPP
+#define INPLACE_BUCKET_STORAGE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+// All blocks are embedded in the object, so no operation touches the heap. insert returns end() once every slot
+// is taken; insert and erase are O(1) and stepping an iterator is O(MaxBlocks) at worst.
+template< typename T, size_t BlockCap, size_t MaxBlocks >
+class InplaceBucketStorage
+{
+	static_assert(BlockCap > 0, "Block capacity must be greater than 0");
+	static_assert(MaxBlocks > 0, "Block count must be greater than 0");
+
+	static constexpr size_t NIL = SIZE_MAX;
+
+	struct Slot
+	{
+		alignas(T) unsigned char data[sizeof(T)];
+		size_t prev;
+		size_t next;
+
+		T *value() noexcept { return std::launder(reinterpret_cast< T * >(data)); }
+	};
+
+	struct BlockState
+	{
+		size_t head;
+		size_t tail;
+		size_t free_head;
+		size_t used;
+		size_t count;
+		size_t next_available;
+		bool in_available;
+	};
+
+	template< bool IsConst >
+	class Iterator
+	{
+		friend class InplaceBucketStorage;
+
+	  public:
+		using value_type = T;
+		using reference = std::conditional_t< IsConst, const T &, T & >;
+		using pointer = std::conditional_t< IsConst, const T *, T * >;
+		using difference_type = std::ptrdiff_t;
+		using iterator_category = std::bidirectional_iterator_tag;
+		using owner_type = std::conditional_t< IsConst, const InplaceBucketStorage, InplaceBucketStorage >;
+
+		Iterator(owner_type *owner, size_t slot);
+
+		template< bool WasConst, typename = std::enable_if_t< IsConst && !WasConst > >
+		Iterator(const Iterator< WasConst > &other);
+
+		reference operator*() const;
+
+		pointer operator->() const;
+
+		Iterator &operator++();
+
+		Iterator operator++(int);
+
+		Iterator &operator--();
+
+		Iterator operator--(int);
+
+		bool operator==(const Iterator &other) const;
+
+		bool operator!=(const Iterator &other) const;
+
+		owner_type *owner;
+		size_t slot;
+	};
+
+  public:
+	using value_type = T;
+	using reference = T &;
+	using const_reference = const T &;
+	using difference_type = std::ptrdiff_t;
+	using iterator = Iterator< false >;
+	using const_iterator = Iterator< true >;
+	using size_type = std::size_t;
+
+	InplaceBucketStorage() noexcept;
+
+	InplaceBucketStorage(const InplaceBucketStorage &other);
+
+	InplaceBucketStorage(InplaceBucketStorage &&other) noexcept(std::is_nothrow_move_constructible_v< T >);
+
+	~InplaceBucketStorage();
+
+	InplaceBucketStorage &operator=(const InplaceBucketStorage &other);
+
+	InplaceBucketStorage &operator=(InplaceBucketStorage &&other) noexcept(std::is_nothrow_move_constructible_v< T >);
+
+	iterator insert(const value_type &value);
+
+	iterator insert(value_type &&value);
+
+	template< typename... Args >
+	iterator emplace(Args &&...args);
+
+	iterator erase(const_iterator it);
+
+	[[nodiscard]] bool empty() const noexcept;
+
+	[[nodiscard]] bool full() const noexcept;
+
+	[[nodiscard]] size_t size() const noexcept;
+
+	size_type capacity() const noexcept;
+
+	void clear() noexcept;
+
+	iterator begin() noexcept;
+
+	iterator end() noexcept;
+
+	const_iterator begin() const noexcept;
+
+	const_iterator end() const noexcept;
+
+	const_iterator cbegin() const noexcept;
+
+	const_iterator cend() const noexcept;
+
+  private:
+	size_t first_slot_from(size_t block) const noexcept;
+
+	size_t last_slot_before(size_t block) const noexcept;
+
+	void push_available(size_t block) noexcept;
+
+	Slot slots[BlockCap * MaxBlocks];
+	BlockState blocks[MaxBlocks];
+	size_t available_head;
+	size_t blocks_used;
+	size_t elements_count;
+};
+
+template< typename T, size_t BlockCap, size_t MaxBlocks >
+template< bool IsConst >
+InplaceBucketStorage< T, BlockCap, MaxBlocks >::Iterator< IsConst >::Iterator(owner_type *owner, size_t slot) :
+	owner(owner), slot(slot)
+{
+}
+
+template< typename T, size_t BlockCap, size_t MaxBlocks >
+template< bool IsConst >
+template< bool WasConst, typename >
+InplaceBucketStorage< T, BlockCap, MaxBlocks >::Iterator< IsConst >::Iterator(const Iterator< WasConst > &other) :
+	owner(other.owner), slot(other.slot)
+{
+}
+
+template< typename T, size_t BlockCap, size_t MaxBlocks >
+template< bool IsConst >
+typename InplaceBucketStorage< T, BlockCap, MaxBlocks >::template Iterator< IsConst >::reference
+	InplaceBucketStorage< T, BlockCap, MaxBlocks >::Iterator< IsConst >::operator*() const
+{
+	if (slot == NIL)
+		throw std::out_of_range("Attempted to dereference end() iterator");
+	return *const_cast< InplaceBucketStorage * >(owner)->slots[slot].value();
+}
+
+template< typename T, size_t BlockCap, size_t MaxBlocks >
+template< bool IsConst >
+typename InplaceBucketStorage< T, BlockCap, MaxBlocks >::template Iterator< IsConst >::pointer
+	InplaceBucketStorage< T, BlockCap, MaxBlocks >::Iterator< IsConst >::operator->() const
+{
+	return &**this;
+}
+
+template< typename T, size_t BlockCap, size_t MaxBlocks >
+template< bool IsConst >
+typename InplaceBucketStorage< T, BlockCap, MaxBlocks >::template Iterator< IsConst > &
+	InplaceBucketStorage< T, BlockCap, MaxBlocks >::Iterator< IsConst >::operator++()
+{
+	if (slot == NIL)
+		throw std::out_of_range("Iterator cannot be incremented past the end");
+	size_t next = owner->slots[slot].next;
+	slot = next != NIL ? next : owner->first_slot_from(slot / BlockCap + 1);
+	return *this;
+}
+
+template< typename T, size_t BlockCap, size_t MaxBlocks >
+template< bool IsConst >
+typename InplaceBucketStorage< T, BlockCap, MaxBlocks >::template Iterator< IsConst >
+	InplaceBucketStorage< T, BlockCap, MaxBlocks >::Iterator< IsConst >::operator++(int)
+{
+	Iterator temp = *this;
+	++(*this);
+	return temp;
+}
+
+template< typename T, size_t BlockCap, size_t MaxBlocks >
+template< bool IsConst >
+typename InplaceBucketStorage< T, BlockCap, MaxBlocks >::template Iterator< IsConst > &
+	InplaceBucketStorage< T, BlockCap, MaxBlocks >::Iterator< IsConst >::operator--()
+{
+	size_t prev = slot == NIL ? NIL : owner->slots[slot].prev;
+	if (prev == NIL)
+		prev = owner->last_slot_before(slot == NIL ? MaxBlocks : slot / BlockCap);
+	if (prev == NIL)
+		throw std::out_of_range("Iterator cannot be decremented before the beginning");
+	slot = prev;
+	return *this;
+}
+
+template< typename T, size_t BlockCap, size_t MaxBlocks >
+template< bool IsConst >
+typename InplaceBucketStorage< T, BlockCap, MaxBlocks >::template Iterator< IsConst >
+	InplaceBucketStorage< T, BlockCap, MaxBlocks >::Iterator< IsConst >::operator--(int)
+{
+	Iterator temp = *this;
+	--(*this);
+	return temp;
+}
+
+template< typename T, size_t BlockCap, size_t MaxBlocks >
+template< bool IsConst >
+bool InplaceBucketStorage< T, BlockCap, MaxBlocks >::Iterator< IsConst >::operator==(const Iterator &other) const
+{
+	return owner == other.owner && slot == other.slot;
+}
+
+template< typename T, size_t BlockCap, size_t MaxBlocks >
+template< bool IsConst >
+bool InplaceBucketStorage< T, BlockCap, MaxBlocks >::Iterator< IsConst >::operator!=(const Iterator &other) const
+{
+	return !(*this == other);
+}
+
+template< typename T, size_t BlockCap, size_t MaxBlocks >
+InplaceBucketStorage< T, BlockCap, MaxBlocks >::InplaceBucketStorage() noexcept :
+	available_head(NIL), blocks_used(0), elements_count(0)
+{
+}
+
+template< typename T, size_t BlockCap, size_t MaxBlocks >
+InplaceBucketStorage< T, BlockCap, MaxBlocks >::InplaceBucketStorage(const InplaceBucketStorage &other) :
+	InplaceBucketStorage()
+{
+	for (const_iterator it = other.begin(); it != other.end(); ++it)
+		insert(*it);
+}
+
+template< typename T, size_t BlockCap, size_t MaxBlocks >
+InplaceBucketStorage< T, BlockCap, MaxBlocks >::InplaceBucketStorage(InplaceBucketStorage &&other) noexcept(
+	std::is_nothrow_move_constructible_v< T >) : InplaceBucketStorage()
+{
+	for (iterator it = other.begin(); it != other.end(); ++it)
+		insert(std::move(*it));
+	other.clear();
+}
+
+template< typename T, size_t BlockCap, size_t MaxBlocks >
+InplaceBucketStorage< T, BlockCap, MaxBlocks >::~InplaceBucketStorage()
+{
+	clear();
+}
+
+template< typename T, size_t BlockCap, size_t MaxBlocks >
+InplaceBucketStorage< T, BlockCap, MaxBlocks > &
+	InplaceBucketStorage< T, BlockCap, MaxBlocks >::operator=(const InplaceBucketStorage &other)
+{
+	if (this != &other)
+	{
+		clear();
+		for (const_iterator it = other.begin(); it != other.end(); ++it)
+			insert(*it);
+	}
+	return *this;
+}
+
+template< typename T, size_t BlockCap, size_t MaxBlocks >
+InplaceBucketStorage< T, BlockCap, MaxBlocks > &InplaceBucketStorage< T, BlockCap, MaxBlocks >::operator=(
+	InplaceBucketStorage &&other) noexcept(std::is_nothrow_move_constructible_v< T >)
+{
+	if (this != &other)
+	{
+		clear();
+		for (iterator it = other.begin(); it != other.end(); ++it)
+			insert(std::move(*it));
+		other.clear();
+	}
+	return *this;
+}
+
+template< typename T, size_t BlockCap, size_t MaxBlocks >
+typename InplaceBucketStorage< T, BlockCap, MaxBlocks >::iterator
+	InplaceBucketStorage< T, BlockCap, MaxBlocks >::insert(const value_type &value)
+{
+	return emplace(value);
+}
+
+template< typename T, size_t BlockCap, size_t MaxBlocks >
+typename InplaceBucketStorage< T, BlockCap, MaxBlocks >::iterator
+	InplaceBucketStorage< T, BlockCap, MaxBlocks >::insert(value_type &&value)
+{
+	return emplace(std::move(value));
+}
+
+template< typename T, size_t BlockCap, size_t MaxBlocks >
+template< typename... Args >
+typename InplaceBucketStorage< T, BlockCap, MaxBlocks >::iterator
+	InplaceBucketStorage< T, BlockCap, MaxBlocks >::emplace(Args &&...args)
+{
+	if (available_head == NIL)
+	{
+		if (blocks_used == MaxBlocks)
+			return end();
+		blocks[blocks_used] = BlockState{ NIL, NIL, NIL, 0, 0, NIL, false };
+		push_available(blocks_used++);
+	}
+
+	size_t block_index = available_head;
+	BlockState &block = blocks[block_index];
+	size_t slot = block.free_head != NIL ? block.free_head : block_index * BlockCap + block.used;
+	::new (static_cast< void * >(slots[slot].data)) T(std::forward< Args >(args)...);
+
+	if (block.free_head == slot)
+		block.free_head = slots[slot].next;
+	else
+		++block.used;
+	slots[slot].prev = block.tail;
+	slots[slot].next = NIL;
+	if (block.tail != NIL)
+		slots[block.tail].next = slot;
+	else
+		block.head = slot;
+	block.tail = slot;
+	++block.count;
+	++elements_count;
+
+	if (block.count == BlockCap)
+	{
+		available_head = block.next_available;
+		block.in_available = false;
+	}
+	return iterator(this, slot);
+}
+
+template< typename T, size_t BlockCap, size_t MaxBlocks >
+typename InplaceBucketStorage< T, BlockCap, MaxBlocks >::iterator
+	InplaceBucketStorage< T, BlockCap, MaxBlocks >::erase(const_iterator it)
+{
+	if (it.owner != this || it.slot == NIL)
+	{
+		throw std::out_of_range("Attempted to erase an invalid iterator");
+	}
+	size_t slot = it.slot;
+	size_t block_index = slot / BlockCap;
+	BlockState &block = blocks[block_index];
+	iterator next(this, slot);
+	++next;
+
+	if (slots[slot].prev != NIL)
+		slots[slots[slot].prev].next = slots[slot].next;
+	else
+		block.head = slots[slot].next;
+	if (slots[slot].next != NIL)
+		slots[slots[slot].next].prev = slots[slot].prev;
+	else
+		block.tail = slots[slot].prev;
+
+	slots[slot].value()->~T();
+	slots[slot].next = block.free_head;
+	block.free_head = slot;
+	--block.count;
+	--elements_count;
+	if (!block.in_available)
+		push_available(block_index);
+	return next;
+}
+
+template< typename T, size_t BlockCap, size_t MaxBlocks >
+bool InplaceBucketStorage< T, BlockCap, MaxBlocks >::empty() const noexcept
+{
+	return elements_count == 0;
+}
+
+template< typename T, size_t BlockCap, size_t MaxBlocks >
+bool InplaceBucketStorage< T, BlockCap, MaxBlocks >::full() const noexcept
+{
+	return elements_count == BlockCap * MaxBlocks;
+}
+
+template< typename T, size_t BlockCap, size_t MaxBlocks >
+size_t InplaceBucketStorage< T, BlockCap, MaxBlocks >::size() const noexcept
+{
+	return elements_count;
+}
+
+template< typename T, size_t BlockCap, size_t MaxBlocks >
+typename InplaceBucketStorage< T, BlockCap, MaxBlocks >::size_type
+	InplaceBucketStorage< T, BlockCap, MaxBlocks >::capacity() const noexcept
+{
+	return BlockCap * MaxBlocks;
+}
+
+template< typename T, size_t BlockCap, size_t MaxBlocks >
+void InplaceBucketStorage< T, BlockCap, MaxBlocks >::clear() noexcept
+{
+	for (size_t b = 0; b < blocks_used; ++b)
+	{
+		for (size_t slot = blocks[b].head; slot != NIL; slot = slots[slot].next)
+			slots[slot].value()->~T();
+	}
+	available_head = NIL;
+	blocks_used = 0;
+	elements_count = 0;
+}
+
+template< typename T, size_t BlockCap, size_t MaxBlocks >
+typename InplaceBucketStorage< T, BlockCap, MaxBlocks >::iterator
+	InplaceBucketStorage< T, BlockCap, MaxBlocks >::begin() noexcept
+{
+	return iterator(this, first_slot_from(0));
+}
+
+template< typename T, size_t BlockCap, size_t MaxBlocks >
+typename InplaceBucketStorage< T, BlockCap, MaxBlocks >::iterator
+	InplaceBucketStorage< T, BlockCap, MaxBlocks >::end() noexcept
+{
+	return iterator(this, NIL);
+}
+
+template< typename T, size_t BlockCap, size_t MaxBlocks >
+typename InplaceBucketStorage< T, BlockCap, MaxBlocks >::const_iterator
+	InplaceBucketStorage< T, BlockCap, MaxBlocks >::begin() const noexcept
+{
+	return const_iterator(this, first_slot_from(0));
+}
+
+template< typename T, size_t BlockCap, size_t MaxBlocks >
+typename InplaceBucketStorage< T, BlockCap, MaxBlocks >::const_iterator
+	InplaceBucketStorage< T, BlockCap, MaxBlocks >::end() const noexcept
+{
+	return const_iterator(this, NIL);
+}
+
+template< typename T, size_t BlockCap, size_t MaxBlocks >
+typename InplaceBucketStorage< T, BlockCap, MaxBlocks >::const_iterator
+	InplaceBucketStorage< T, BlockCap, MaxBlocks >::cbegin() const noexcept
+{
+	return begin();
+}
+
+template< typename T, size_t BlockCap, size_t MaxBlocks >
+typename InplaceBucketStorage< T, BlockCap, MaxBlocks >::const_iterator
+	InplaceBucketStorage< T, BlockCap, MaxBlocks >::cend() const noexcept
+{
+	return end();
+}
+
+template< typename T, size_t BlockCap, size_t MaxBlocks >
+size_t InplaceBucketStorage< T, BlockCap, MaxBlocks >::first_slot_from(size_t block) const noexcept
+{
+	for (; block < blocks_used; ++block)
+		if (blocks[block].head != NIL)
+			return blocks[block].head;
+	return NIL;
+}
+
+template< typename T, size_t BlockCap, size_t MaxBlocks >
+size_t InplaceBucketStorage< T, BlockCap, MaxBlocks >::last_slot_before(size_t block) const noexcept
+{
+	for (block = block < blocks_used ? block : blocks_used; block > 0; --block)
+		if (blocks[block - 1].tail != NIL)
+			return blocks[block - 1].tail;
+	return NIL;
+}
+
+template< typename T, size_t BlockCap, size_t MaxBlocks >
+void InplaceBucketStorage< T, BlockCap, MaxBlocks >::push_available(size_t block) noexcept
+{
+	blocks[block].next_available = available_head;
+	blocks[block].in_available = true;
+	available_head = block;
+}
+
+#endif /* INPLACE_BUCKET_STORAGE_HPP */
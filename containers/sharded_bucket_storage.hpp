@@ -0,0 +1,450 @@
+#ifndef SHARDED_BUCKET_STORAGE_HPP
+#define SHARDED_BUCKET_STORAGE_HPP
+
+#include "bucket_storage.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+template< typename T >
+class ShardedBucketStorage;
+
+template< typename T >
+class ShardedBucketStorageIterator
+{
+  public:
+	using value_type = T;
+	using reference = T &;
+	using pointer = T *;
+	using difference_type = std::ptrdiff_t;
+	using iterator_category = std::forward_iterator_tag;
+	using local_iterator = BucketStorageIterator< T >;
+
+	ShardedBucketStorageIterator(ShardedBucketStorage< T > *owner, size_t shard, local_iterator position);
+
+	reference operator*() const;
+
+	pointer operator->() const;
+
+	ShardedBucketStorageIterator &operator++();
+
+	ShardedBucketStorageIterator operator++(int);
+
+	bool operator==(const ShardedBucketStorageIterator &other) const;
+
+	bool operator!=(const ShardedBucketStorageIterator &other) const;
+
+	ShardedBucketStorage< T > *owner;
+	size_t shard;
+	local_iterator position;
+
+	void skip_empty_shards();
+};
+
+// Each thread inserts into and erases from a shard it owns without synchronization. Erasing an element of
+// another thread's shard queues it for the owner, which applies queued erases on its next insert, erase or drain.
+// An element of an unowned shard is erased directly. Erasing never claims a shard for the calling thread.
+// A thread that exits without release_local_shard() gives its shards back, with their queued erases applied, when
+// its thread-local storage is destroyed. Global iteration, size() and shard() must not race with writers.
+template< typename T >
+class ShardedBucketStorage
+{
+	friend class ShardedBucketStorageIterator< T >;
+
+  public:
+	using value_type = T;
+	using reference = T &;
+	using const_reference = const T &;
+	using difference_type = std::ptrdiff_t;
+	using iterator = ShardedBucketStorageIterator< T >;
+	using size_type = std::size_t;
+
+	explicit ShardedBucketStorage();
+
+	explicit ShardedBucketStorage(size_t shard_count, size_t block_capacity = 64);
+
+	ShardedBucketStorage(const ShardedBucketStorage &other) = delete;
+
+	ShardedBucketStorage &operator=(const ShardedBucketStorage &other) = delete;
+
+	~ShardedBucketStorage();
+
+	iterator insert(const value_type &value);
+
+	iterator insert(value_type &&value);
+
+	void erase(const iterator &it);
+
+	void drain();
+
+	void release_local_shard();
+
+	[[nodiscard]] bool empty() const noexcept;
+
+	[[nodiscard]] size_t size() const noexcept;
+
+	[[nodiscard]] size_t shard_count() const noexcept;
+
+	BucketStorage< T > &shard(size_t index);
+
+	iterator begin();
+
+	iterator end();
+
+  private:
+	struct RemoteErase
+	{
+		BucketStorageConstIterator< T > position;
+		RemoteErase *next;
+	};
+
+	struct alignas(64) Shard
+	{
+		BucketStorage< T > storage;
+		std::atomic< std::thread::id > owner;
+		std::atomic< RemoteErase * > remote_erases;
+	};
+
+	struct LocalShardCache
+	{
+		uint64_t instance;
+		size_t shard;
+	};
+
+	// Shards claimed by the current thread, released on thread exit if their storage still exists.
+	struct ShardLeases
+	{
+		std::vector< std::pair< uint64_t, size_t > > leases;
+
+		~ShardLeases();
+	};
+
+	static inline std::atomic< uint64_t > next_instance = 1;
+	static inline thread_local LocalShardCache local_cache = { 0, 0 };
+	static inline thread_local ShardLeases local_leases;
+	static inline std::mutex registry_mutex;
+	static inline std::unordered_map< uint64_t, ShardedBucketStorage * > registry;
+
+	size_t local_shard();
+
+	size_t owned_shard() noexcept;
+
+	size_t find_local_shard() const noexcept;
+
+	void drain_remote(Shard &shard);
+
+	void release_shard(size_t index);
+
+	size_t shards_count;
+	Shard *shards;
+	uint64_t instance;
+};
+
+template< typename T >
+ShardedBucketStorageIterator< T >::ShardedBucketStorageIterator(ShardedBucketStorage< T > *owner,
+																size_t shard,
+																local_iterator position) :
+	owner(owner), shard(shard), position(position)
+{
+}
+
+template< typename T >
+typename ShardedBucketStorageIterator< T >::reference ShardedBucketStorageIterator< T >::operator*() const
+{
+	if (shard == owner->shards_count)
+		throw std::out_of_range("Attempted to dereference end() iterator");
+	return *position;
+}
+
+template< typename T >
+typename ShardedBucketStorageIterator< T >::pointer ShardedBucketStorageIterator< T >::operator->() const
+{
+	if (shard == owner->shards_count)
+		throw std::out_of_range("Attempted to dereference end() iterator");
+	return position.operator->();
+}
+
+template< typename T >
+ShardedBucketStorageIterator< T > &ShardedBucketStorageIterator< T >::operator++()
+{
+	if (shard == owner->shards_count)
+		throw std::out_of_range("Iterator cannot be incremented past the end");
+	++position;
+	skip_empty_shards();
+	return *this;
+}
+
+template< typename T >
+ShardedBucketStorageIterator< T > ShardedBucketStorageIterator< T >::operator++(int)
+{
+	ShardedBucketStorageIterator temp = *this;
+	++(*this);
+	return temp;
+}
+
+template< typename T >
+bool ShardedBucketStorageIterator< T >::operator==(const ShardedBucketStorageIterator &other) const
+{
+	return owner == other.owner && shard == other.shard && (shard == owner->shards_count || position == other.position);
+}
+
+template< typename T >
+bool ShardedBucketStorageIterator< T >::operator!=(const ShardedBucketStorageIterator &other) const
+{
+	return !(*this == other);
+}
+
+template< typename T >
+void ShardedBucketStorageIterator< T >::skip_empty_shards()
+{
+	while (shard < owner->shards_count && position == owner->shards[shard].storage.end())
+	{
+		if (++shard < owner->shards_count)
+			position = owner->shards[shard].storage.begin();
+	}
+}
+
+template< typename T >
+ShardedBucketStorage< T >::ShardedBucketStorage() :
+	ShardedBucketStorage(std::thread::hardware_concurrency() ? std::thread::hardware_concurrency() : 1)
+{
+}
+
+template< typename T >
+ShardedBucketStorage< T >::ShardedBucketStorage(size_t shard_count, size_t block_capacity) :
+	shards_count(shard_count), shards(nullptr), instance(next_instance.fetch_add(1, std::memory_order_relaxed))
+{
+	if (shard_count == 0)
+	{
+		throw std::invalid_argument("Shard count must be greater than 0");
+	}
+	shards = new Shard[shard_count];
+	for (size_t i = 0; i < shard_count; ++i)
+	{
+		shards[i].storage = BucketStorage< T >(block_capacity);
+		shards[i].remote_erases.store(nullptr, std::memory_order_relaxed);
+	}
+	std::lock_guard< std::mutex > lock(registry_mutex);
+	registry.emplace(instance, this);
+}
+
+template< typename T >
+ShardedBucketStorage< T >::~ShardedBucketStorage()
+{
+	{
+		std::lock_guard< std::mutex > lock(registry_mutex);
+		registry.erase(instance);
+	}
+	for (size_t i = 0; i < shards_count; ++i)
+	{
+		RemoteErase *node = shards[i].remote_erases.exchange(nullptr, std::memory_order_acquire);
+		while (node)
+		{
+			RemoteErase *next = node->next;
+			delete node;
+			node = next;
+		}
+	}
+	delete[] shards;
+}
+
+template< typename T >
+typename ShardedBucketStorage< T >::iterator ShardedBucketStorage< T >::insert(const value_type &value)
+{
+	size_t index = local_shard();
+	drain_remote(shards[index]);
+	return iterator(this, index, shards[index].storage.insert(value));
+}
+
+template< typename T >
+typename ShardedBucketStorage< T >::iterator ShardedBucketStorage< T >::insert(value_type &&value)
+{
+	size_t index = local_shard();
+	drain_remote(shards[index]);
+	return iterator(this, index, shards[index].storage.insert(std::move(value)));
+}
+
+template< typename T >
+void ShardedBucketStorage< T >::erase(const iterator &it)
+{
+	if (it.owner != this || it.shard >= shards_count)
+	{
+		throw std::invalid_argument("Iterator does not belong to this storage");
+	}
+	Shard &target = shards[it.shard];
+	std::thread::id unowned;
+	if (owned_shard() == it.shard)
+	{
+		drain_remote(target);
+		target.storage.erase(it.position);
+		return;
+	}
+	if (target.owner.compare_exchange_strong(unowned, std::this_thread::get_id(), std::memory_order_acq_rel))
+	{
+		drain_remote(target);
+		target.storage.erase(it.position);
+		target.owner.store(std::thread::id(), std::memory_order_release);
+		return;
+	}
+	std::atomic< RemoteErase * > &head = target.remote_erases;
+	auto *node = new RemoteErase{ it.position, head.load(std::memory_order_relaxed) };
+	while (!head.compare_exchange_weak(node->next, node, std::memory_order_release, std::memory_order_relaxed))
+	{
+	}
+}
+
+template< typename T >
+void ShardedBucketStorage< T >::drain()
+{
+	drain_remote(shards[local_shard()]);
+}
+
+template< typename T >
+void ShardedBucketStorage< T >::release_local_shard()
+{
+	size_t index = find_local_shard();
+	if (index == shards_count)
+		return;
+	release_shard(index);
+	std::erase(local_leases.leases, std::make_pair(instance, index));
+	local_cache = { 0, 0 };
+}
+
+template< typename T >
+bool ShardedBucketStorage< T >::empty() const noexcept
+{
+	return size() == 0;
+}
+
+template< typename T >
+size_t ShardedBucketStorage< T >::size() const noexcept
+{
+	size_t total = 0;
+	for (size_t i = 0; i < shards_count; ++i)
+		total += shards[i].storage.size();
+	return total;
+}
+
+template< typename T >
+size_t ShardedBucketStorage< T >::shard_count() const noexcept
+{
+	return shards_count;
+}
+
+template< typename T >
+BucketStorage< T > &ShardedBucketStorage< T >::shard(size_t index)
+{
+	if (index >= shards_count)
+	{
+		throw std::out_of_range("Shard index out of range");
+	}
+	return shards[index].storage;
+}
+
+template< typename T >
+typename ShardedBucketStorage< T >::iterator ShardedBucketStorage< T >::begin()
+{
+	iterator it(this, 0, shards[0].storage.begin());
+	it.skip_empty_shards();
+	return it;
+}
+
+template< typename T >
+typename ShardedBucketStorage< T >::iterator ShardedBucketStorage< T >::end()
+{
+	return iterator(this, shards_count, shards[shards_count - 1].storage.end());
+}
+
+template< typename T >
+size_t ShardedBucketStorage< T >::local_shard()
+{
+	if (local_cache.instance == instance)
+		return local_cache.shard;
+
+	size_t index = find_local_shard();
+	if (index == shards_count)
+	{
+		std::thread::id self = std::this_thread::get_id();
+		for (index = 0; index < shards_count; ++index)
+		{
+			std::thread::id unowned;
+			if (shards[index].owner.compare_exchange_strong(unowned, self, std::memory_order_acq_rel))
+				break;
+		}
+		if (index == shards_count)
+		{
+			throw std::overflow_error("Too many threads for shard count");
+		}
+		try
+		{
+			local_leases.leases.emplace_back(instance, index);
+		} catch (...)
+		{
+			shards[index].owner.store(std::thread::id(), std::memory_order_release);
+			throw;
+		}
+	}
+	local_cache = { instance, index };
+	return index;
+}
+
+template< typename T >
+size_t ShardedBucketStorage< T >::owned_shard() noexcept
+{
+	if (local_cache.instance == instance)
+		return local_cache.shard;
+	size_t index = find_local_shard();
+	if (index != shards_count)
+		local_cache = { instance, index };
+	return index;
+}
+
+template< typename T >
+size_t ShardedBucketStorage< T >::find_local_shard() const noexcept
+{
+	std::thread::id self = std::this_thread::get_id();
+	for (size_t i = 0; i < shards_count; ++i)
+		if (shards[i].owner.load(std::memory_order_acquire) == self)
+			return i;
+	return shards_count;
+}
+
+template< typename T >
+void ShardedBucketStorage< T >::drain_remote(Shard &shard)
+{
+	RemoteErase *node = shard.remote_erases.exchange(nullptr, std::memory_order_acquire);
+	while (node)
+	{
+		RemoteErase *next = node->next;
+		shard.storage.erase(node->position);
+		delete node;
+		node = next;
+	}
+}
+
+template< typename T >
+void ShardedBucketStorage< T >::release_shard(size_t index)
+{
+	drain_remote(shards[index]);
+	shards[index].owner.store(std::thread::id(), std::memory_order_release);
+}
+
+template< typename T >
+ShardedBucketStorage< T >::ShardLeases::~ShardLeases()
+{
+	std::lock_guard< std::mutex > lock(registry_mutex);
+	for (const auto &[instance, index] : leases)
+	{
+		auto it = registry.find(instance);
+		if (it != registry.end() && it->second->find_local_shard() == index)
+			it->second->release_shard(index);
+	}
+}
+
+#endif /* SHARDED_BUCKET_STORAGE_HPP */
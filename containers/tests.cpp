@@ -1,13 +1,25 @@
+#include "archetype_storage.hpp"
+#include "bucket_hash_map.hpp"
+#include "bucket_lru.hpp"
 #include "bucket_storage.hpp"
 #include "helpers.hpp"
+#include "inplace_bucket_storage.hpp"
+#include "sharded_bucket_storage.hpp"
 #include <type_traits>
 
 #include <gtest/gtest.h>
 
 #include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <fstream>
 #include <iostream>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <thread>
 #include <utility>
+#include <vector>
 
 TEST(traits, default_constructor)
 {
@@ -356,6 +368,161 @@ TEST(base, swap)
 	ASSERT_EQ(e.size(), n);
 }
 
+TEST(base, insert_hint)
+{
+	bs_sizet_t b = bs_sizet_t(4);
+	for (size_t i = 0; i < 12; ++i)
+		b.insert(i);
+	ASSERT_EQ(b.capacity(), 12);
+
+	bs_sizet_t::iterator first = std::find(b.begin(), b.end(), 1);
+	b.erase(first);
+	bs_sizet_t::iterator hint = std::find(b.begin(), b.end(), 2);
+
+	bs_sizet_t::iterator it = b.insert(hint, 100);
+	ASSERT_EQ(*it, 100);
+	ASSERT_EQ(it.current_block, hint.current_block);
+	ASSERT_EQ(b.capacity(), 12);
+
+	it = b.insert(hint, 101);
+	ASSERT_NE(it.current_block, hint.current_block);
+	ASSERT_EQ(b.capacity(), 16);
+
+	b.erase(std::find(b.begin(), b.end(), 5));
+	bs_sizet_t::iterator emplaced = b.emplace_hint(hint, 102);
+	ASSERT_EQ(*emplaced, 102);
+	ASSERT_EQ(emplaced.current_block, hint.current_block->next_block);
+	ASSERT_EQ(b.size(), 13);
+}
+
+TEST(base, insert_with_affinity)
+{
+	bs_sizet_t b = bs_sizet_t(4);
+	for (size_t i = 0; i < 24; ++i)
+		b.insert_with_affinity(i % 3, i);
+	ASSERT_EQ(b.capacity(), 24);
+
+	for (bs_sizet_t::iterator it = b.begin(); it != b.end(); ++it)
+		for (bs_sizet_t::iterator jt = it; jt != b.end() && jt.current_block == it.current_block; ++jt)
+			ASSERT_EQ(*jt % 3, *it % 3);
+}
+
+TEST(base, affinity_blocks_stay_private)
+{
+	bs_sizet_t b = bs_sizet_t(4);
+	bs_sizet_t::iterator grouped = b.insert_with_affinity(7, 100);
+	bs_sizet_t::iterator plain = b.insert(size_t(0));
+	ASSERT_NE(plain.current_block, grouped.current_block);
+	for (size_t i = 1; i < 4; ++i)
+		ASSERT_EQ(b.insert(i).current_block, plain.current_block);
+	ASSERT_EQ(b.insert(b.cbegin(), size_t(4)).current_block->affinity_slot, SIZE_MAX);
+	ASSERT_EQ(b.insert_with_affinity(7 + 64, 101).current_block, grouped.current_block);
+	ASSERT_EQ(b.capacity(), 12);
+
+	bs_sizet_t::iterator full_group = grouped;
+	b.insert_with_affinity(7, 102);
+	b.insert_with_affinity(7, 103);
+	grouped = b.insert_with_affinity(7, 104);
+	ASSERT_NE(grouped.current_block, full_group.current_block);
+	for (size_t i = 105; i < 108; ++i)
+		b.insert_with_affinity(7, i);
+	Block< size_t > *reopened = full_group.current_block;
+	b.erase(full_group);
+	for (size_t i = 5; i < 8; ++i)
+		ASSERT_NE(b.insert(i).current_block, reopened);
+	ASSERT_EQ(b.insert_with_affinity(7, 108).current_block, reopened);
+	ASSERT_EQ(b.size(), 16);
+}
+
+TEST(base, adaptive_block_capacity)
+{
+	ASSERT_THROW(bs_sizet_t(8, 4), std::invalid_argument);
+
+	bs_sizet_t b = bs_sizet_t(4, 256);
+	size_t n = 10000;
+	for (size_t i = 0; i < n; ++i)
+		b.insert(i);
+	ASSERT_GE(b.capacity(), n);
+	ASSERT_LT(b.capacity() - n, 256);
+
+	size_t blocks = 0;
+	for (bs_sizet_t::iterator it = b.begin(); it != b.end(); ++it)
+		if (it == b.begin() || it.current_block != std::prev(it).current_block)
+			++blocks;
+	ASSERT_LT(blocks, 100);
+
+	bs_sizet_t c = b;
+	ASSERT_EQ(c.capacity(), b.capacity());
+
+	while (!b.empty())
+		b.erase(b.begin());
+	ASSERT_EQ(b.capacity(), 0);
+	b.insert(0);
+	ASSERT_EQ(b.capacity(), 4);
+}
+
+TEST(base, slot_reuse)
+{
+	bs_sizet_t b = bs_sizet_t(4);
+	std::vector< size_t * > addresses;
+	for (size_t i = 0; i < 4; ++i)
+		addresses.push_back(&*b.insert(i));
+
+	b.erase(std::find(b.begin(), b.end(), 2));
+	ASSERT_EQ(&*b.insert(4), addresses[2]);
+	ASSERT_EQ(b.capacity(), 4);
+}
+
+TEST(base, merge_and_split)
+{
+	bs_co_t a = bs_co_t(4);
+	bs_co_t b = bs_co_t(4);
+	for (size_t i = 0; i < 100; ++i)
+	{
+		a.insert(CountedOperationObject(i));
+		b.insert(CountedOperationObject(100 + i));
+	}
+	b.mark_erased(b.begin());
+
+	opCount.clearCounters();
+	a.merge(std::move(b));
+	ASSERT_EQ(opCount, NO_OP);
+	ASSERT_EQ(a.size(), 199);
+	ASSERT_EQ(a.capacity(), 200);
+	ASSERT_TRUE(b.empty());
+	ASSERT_EQ(b.capacity(), 0);
+
+	size_t sum = 0;
+	for (bs_co_t::iterator it = a.begin(); it != a.end(); ++it)
+		sum += it->number;
+	ASSERT_EQ(sum, 199 * 200 / 2 - 100);
+
+	b.insert(CountedOperationObject(0));
+	ASSERT_EQ(b.size(), 1);
+
+	opCount.clearCounters();
+	std::vector< bs_co_t > parts = a.split(3);
+	ASSERT_EQ(opCount, NO_OP);
+	ASSERT_EQ(parts.size(), 3);
+	ASSERT_TRUE(a.empty());
+	ASSERT_EQ(a.capacity(), 0);
+
+	size_t total = 0;
+	size_t split_sum = 0;
+	for (bs_co_t &part : parts)
+	{
+		ASSERT_GT(part.size(), 50);
+		total += part.size();
+		for (bs_co_t::iterator it = part.begin(); it != part.end(); ++it)
+			split_sum += it->number;
+		part.compact();
+		part.insert(CountedOperationObject(0));
+	}
+	ASSERT_EQ(total, 199);
+	ASSERT_EQ(split_sum, sum);
+	ASSERT_THROW(a.split(0), std::invalid_argument);
+}
+
 TEST(coperators, simple_five_rule_count)
 {
 	bs_co_t b = prepare();
@@ -363,6 +530,7 @@ TEST(coperators, simple_five_rule_count)
 
 	bs_co_t c = b;
 	ASSERT_EQ(opCount, OpCount(0, n, 0, 0, 0, 0));
+	ASSERT_EQ(c.size(), n);
 
 	opCount.clearCounters();
 	bs_co_t d = std::move(b);
@@ -375,6 +543,7 @@ TEST(coperators, simple_five_rule_count)
 	opCount.clearCounters();
 	c = def;
 	ASSERT_EQ(opCount, OpCount(0, n / 2, 0, 0, 0, n));
+	ASSERT_EQ(c.size(), n / 2);
 
 	opCount.clearCounters();
 	d = std::move(def);
@@ -404,6 +573,73 @@ TEST(coperators, with_self)
 	ASSERT_EQ(opCount, NO_OP);
 }
 
+TEST(coperators, copy_is_independent)
+{
+	bs_co_t b = prepare();
+	size_t n = b.size();
+	bs_co_t snapshot = b;
+	ASSERT_EQ(opCount, OpCount(0, n, 0, 0, 0, 0));
+
+	opCount.clearCounters();
+	b.insert(CountedOperationObject(n));
+	b.erase(b.cbegin());
+	ASSERT_EQ(b.size(), n);
+	ASSERT_EQ(snapshot.size(), n);
+
+	bs_co_t::iterator it = b.begin();
+	it->number = 2 * n;
+
+	size_t sum = 0;
+	for (bs_co_t::const_iterator jt = snapshot.cbegin(); jt != snapshot.cend(); ++jt)
+		sum += jt->number;
+	ASSERT_EQ(sum, n * (n - 1) / 2);
+
+	size_t modified = 0;
+	for (const CountedOperationObject &i : std::as_const(b))
+		modified += i.number == 2 * n;
+	ASSERT_EQ(modified, 1);
+}
+
+TEST(coperators, copy_keeps_iterators_and_references)
+{
+	auto check = []< typename V >(BucketStorage< V > storage, auto make)
+	{
+		for (size_t i = 0; i < 16; ++i)
+			storage.insert(make(i));
+
+		auto first = storage.begin();
+		auto second = std::next(first, 5);
+		auto third = std::next(first, 11);
+		V &first_ref = *first;
+		V &second_ref = *second;
+		V *third_address = &*third;
+
+		BucketStorage< V > snapshot = storage;
+		auto snapshot_first = snapshot.begin();
+		auto snapshot_second = std::next(snapshot_first, 5);
+
+		*first = make(100);
+		*second = make(200);
+		*third = make(300);
+		*snapshot_second = make(500);
+
+		ASSERT_EQ(&first_ref, &*first);
+		ASSERT_EQ(&second_ref, &*second);
+		ASSERT_EQ(third_address, &*third);
+		ASSERT_EQ(first_ref, make(100));
+		ASSERT_EQ(second_ref, make(200));
+		ASSERT_EQ(*third_address, make(300));
+		ASSERT_EQ(*std::next(storage.begin(), 5), make(200));
+
+		ASSERT_NE(&*snapshot_first, &first_ref);
+		ASSERT_EQ(*snapshot_first, make(0));
+		ASSERT_EQ(*snapshot_second, make(500));
+		ASSERT_EQ(*std::next(snapshot.begin(), 11), make(11));
+	};
+	check(BucketStorage< size_t >(16), [](size_t i) { return i; });
+	check(BucketStorage< std::string >(16), [](size_t i) { return std::to_string(i); });
+}
+
 TEST(iterators, iter_const_eq)
 {
 	bs_co_t b = prepare();
@@ -445,6 +681,937 @@ TEST(iterators, member_of_pointer)
 	}
 }
 
+TEST(iterators, prefetch_distance)
+{
+	bs_sizet_t b = bs_sizet_t(8, 64);
+	ASSERT_EQ(b.get_prefetch_distance(), 32);
+	for (size_t i = 0; i < 1000; ++i)
+	{
+		bs_sizet_t::iterator it = b.insert(i);
+		if (i % 3 == 0)
+			b.mark_erased(it);
+	}
+
+	for (size_t distance : { 0, 1, 7, 64, 500 })
+	{
+		b.set_prefetch_distance(distance);
+		bs_sizet_t copy = b;
+		ASSERT_EQ(copy.get_prefetch_distance(), distance);
+		size_t expected = 1;
+		for (size_t i : std::as_const(copy))
+		{
+			ASSERT_EQ(i, expected);
+			expected += expected % 3 == 2 ? 2 : 1;
+		}
+		ASSERT_EQ(std::accumulate(b.begin(), b.end(), size_t(0)), std::accumulate(copy.begin(), copy.end(), size_t(0)));
+	}
+}
+
+TEST(tombstones, mark_erased)
+{
+	bs_co_t b = prepare();
+	size_t n = b.size();
+	size_t capacity = b.capacity();
+
+	for (bs_co_t::iterator it = b.begin(); it != b.end();)
+	{
+		if (it->number % 2 == 0)
+			it = b.mark_erased(it);
+		else
+			++it;
+	}
+	ASSERT_EQ(b.size(), n / 2);
+	ASSERT_EQ(b.capacity(), capacity);
+	ASSERT_EQ(opCount, NO_OP);
+
+	size_t counter = 0;
+	for (const CountedOperationObject &i : b)
+	{
+		ASSERT_EQ(i.number % 2, 1);
+		counter++;
+	}
+	ASSERT_EQ(counter, b.size());
+
+	counter = 0;
+	bs_co_t::iterator it = b.end();
+	do
+	{
+		--it;
+		ASSERT_EQ(it->number % 2, 1);
+		counter++;
+	} while (it != b.begin());
+	ASSERT_EQ(counter, b.size());
+}
+
+TEST(tombstones, compact)
+{
+	bs_co_t b = prepare();
+	size_t n = b.size();
+
+	for (bs_co_t::iterator it = b.begin(); it != b.end();)
+	{
+		if (it->number < n - 100)
+			it = b.mark_erased(it);
+		else
+			++it;
+	}
+	ASSERT_EQ(b.size(), 100);
+	ASSERT_EQ(b.capacity(), (n + 63) & -64);
+
+	b.compact();
+	ASSERT_EQ(opCount, OpCount(0, 0, 0, 0, 0, n - 100));
+	ASSERT_EQ(b.size(), 100);
+	ASSERT_EQ(b.capacity(), 128);
+
+	size_t sum = 0;
+	for (const CountedOperationObject &i : b)
+		sum += i.number;
+	ASSERT_EQ(sum, (n - 100 + n - 1) * 100 / 2);
+}
+
+TEST(tombstones, all_erased)
+{
+	bs_sizet_t b = bs_sizet_t(4);
+	for (size_t i = 0; i < 10; ++i)
+		b.insert(i);
+	for (bs_sizet_t::iterator it = b.begin(); it != b.end();)
+		it = b.mark_erased(it);
+
+	ASSERT_TRUE(b.empty());
+	ASSERT_EQ(b.begin(), b.end());
+
+	b.insert(42);
+	ASSERT_EQ(b.size(), 1);
+	ASSERT_EQ(*b.begin(), 42);
+
+	b.erase(b.begin());
+	b.compact();
+	ASSERT_TRUE(b.empty());
+	ASSERT_EQ(b.capacity(), 0);
+	ASSERT_EQ(b.begin(), b.end());
+}
+
+TEST(defragment, erase_refills_full_blocks)
+{
+	bs_sizet_t b = bs_sizet_t(4);
+	for (size_t i = 0; i < 8; ++i)
+		b.insert(i);
+	b.erase(b.begin());
+	b.erase(std::find(b.begin(), b.end(), 5));
+	b.insert(8);
+	b.insert(9);
+	ASSERT_EQ(b.size(), 8);
+	ASSERT_EQ(b.capacity(), 8);
+}
+
+TEST(defragment, incremental_steps)
+{
+	bs_sizet_t b = bs_sizet_t(4);
+	size_t n = 400;
+	for (size_t i = 0; i < n; ++i)
+		b.insert(i);
+	for (bs_sizet_t::iterator it = b.begin(); it != b.end();)
+	{
+		if (*it % 4 != 0)
+			it = b.erase(it);
+		else
+			++it;
+	}
+	ASSERT_EQ(b.size(), n / 4);
+	ASSERT_EQ(b.capacity(), n);
+
+	size_t steps = 0;
+	size_t moved = 0;
+	size_t freed = 0;
+	for (bool done = false; !done; ++steps)
+	{
+		bs_sizet_t::DefragmentProgress progress = b.defragment_step(10);
+		ASSERT_LE(progress.moved, 10);
+		moved += progress.moved;
+		freed += progress.blocks_freed;
+		done = progress.done;
+	}
+	ASSERT_GT(steps, 1);
+	ASSERT_GT(moved, 0);
+	ASSERT_EQ(b.size(), n / 4);
+	ASSERT_EQ(b.capacity(), n / 4);
+	ASSERT_EQ(b.capacity(), n - 4 * freed);
+
+	size_t sum = 0;
+	for (size_t value : b)
+		sum += value;
+	ASSERT_EQ(sum, 4 * (n / 4) * (n / 4 - 1) / 2);
+
+	bs_sizet_t::DefragmentProgress progress = b.defragment_for(std::chrono::microseconds(50));
+	ASSERT_TRUE(progress.done);
+	ASSERT_EQ(progress.moved, 0);
+}
+
+TEST(defragment, frees_affinity_blocks)
+{
+	bs_sizet_t b = bs_sizet_t(4);
+	for (size_t i = 0; i < 8; ++i)
+		b.insert(i);
+	b.erase(b.insert_with_affinity(7, 100));
+	b.insert_with_affinity(7, 101);
+	b.insert_with_affinity(7, 102);
+	ASSERT_EQ(b.capacity(), 12);
+
+	b.erase(std::find(b.begin(), b.end(), 0));
+	b.erase(std::find(b.begin(), b.end(), 1));
+	bs_sizet_t::DefragmentProgress progress = b.defragment_step(64);
+	ASSERT_TRUE(progress.done);
+	ASSERT_EQ(progress.blocks_freed, 1);
+	ASSERT_EQ(b.capacity(), 8);
+
+	ASSERT_EQ(*b.insert_with_affinity(7, 103), 103);
+	ASSERT_EQ(b.size(), 9);
+	ASSERT_EQ(b.capacity(), 12);
+}
+
+TEST(reclamation, deferred_erase)
+{
+	bs_co_t b = prepare();
+	size_t n = b.size();
+	b.enable_deferred_reclamation();
+
+	for (size_t i = 0; i < n / 2; ++i)
+		b.erase(b.begin());
+	ASSERT_EQ(b.size(), n - n / 2);
+
+	b.collect_retired();
+	ASSERT_EQ(opCount.dtorCount, n / 2);
+
+	size_t counter = 0;
+	b.concurrent_for_each([&counter](const CountedOperationObject &) { counter++; });
+	ASSERT_EQ(counter, b.size());
+}
+
+TEST(reclamation, shrink_keeps_retired)
+{
+	bs_co_t b = prepare();
+	size_t n = b.size();
+	b.enable_deferred_reclamation();
+	for (size_t i = 0; i < n / 2; ++i)
+		b.erase(b.begin());
+
+	b.shrink_to_fit();
+	ASSERT_EQ(b.size(), n - n / 2);
+	size_t destroyed = opCount.dtorCount;
+	b.collect_retired();
+	ASSERT_GT(opCount.dtorCount, destroyed);
+	ASSERT_EQ(opCount.dtorCount, n);
+}
+
+TEST(reclamation, concurrent_readers)
+{
+	constexpr size_t n = 4096;
+	constexpr size_t readers_count = 3;
+	bs_sizet_t b = bs_sizet_t(16);
+	b.enable_deferred_reclamation();
+	for (size_t i = 0; i < n; ++i)
+		b.insert(i);
+
+	std::atomic< bool > stop = false;
+	std::atomic< size_t > bad_values = 0;
+	std::vector< std::thread > readers;
+	for (size_t r = 0; r < readers_count; ++r)
+	{
+		readers.emplace_back(
+			[&]
+			{
+				while (!stop.load())
+				{
+					b.concurrent_for_each(
+						[&bad_values](const size_t &value)
+						{
+							if (value >= 2 * n)
+								bad_values++;
+						});
+				}
+			});
+	}
+
+	for (size_t round = 0; round < 8; ++round)
+	{
+		for (bs_sizet_t::iterator it = b.begin(); it != b.end();)
+		{
+			if (*it % 3 == round % 3)
+				it = b.erase(it);
+			else
+				++it;
+		}
+		for (size_t i = 0; i < n / 2; ++i)
+			b.insert(n + i);
+		for (bs_sizet_t::iterator it = b.begin(); it != b.end();)
+			it = *it % 2 == 0 ? b.mark_erased(it) : ++it;
+		b.compact();
+	}
+	stop = true;
+	for (std::thread &reader : readers)
+		reader.join();
+
+	ASSERT_EQ(bad_values, 0);
+	size_t counter = 0;
+	b.concurrent_for_each([&counter](const size_t &) { counter++; });
+	ASSERT_EQ(counter, b.size());
+}
+
+// Runs concurrent_for_each on two threads and counts values that are not the payload a writer keeps inserting.
+struct PayloadReaders
+{
+	using storage_t = BucketStorage< std::string >;
+
+	inline static const std::string payload = std::string(32, 'x');
+
+	std::atomic< bool > stop = false;
+	std::atomic< size_t > bad_values = 0;
+	std::vector< std::thread > threads;
+
+	static void fill(storage_t &storage, size_t n)
+	{
+		for (size_t i = 0; i < n; ++i)
+			storage.insert(payload);
+	}
+
+	static void thin_out(storage_t &storage)
+	{
+		size_t i = 0;
+		for (storage_t::iterator it = storage.begin(); it != storage.end(); ++i)
+			it = i % 4 != 0 ? storage.erase(it) : ++it;
+	}
+
+	void start(storage_t &storage)
+	{
+		for (size_t r = 0; r < 2; ++r)
+		{
+			threads.emplace_back(
+				[this, &storage]
+				{
+					while (!stop.load())
+					{
+						storage.concurrent_for_each(
+							[this](const std::string &value)
+							{
+								if (value != payload)
+									bad_values++;
+							});
+					}
+				});
+		}
+	}
+
+	void join()
+	{
+		stop = true;
+		for (std::thread &thread : threads)
+			thread.join();
+		threads.clear();
+		stop = false;
+	}
+};
+
+TEST(reclamation, readers_during_defragment)
+{
+	PayloadReaders readers;
+	PayloadReaders::storage_t b(16);
+	b.enable_deferred_reclamation();
+	PayloadReaders::fill(b, 4096);
+	readers.start(b);
+	for (size_t round = 0; round < 4; ++round)
+	{
+		PayloadReaders::thin_out(b);
+		while (!b.defragment_step(64).done)
+		{
+		}
+		PayloadReaders::fill(b, 3072);
+	}
+	readers.join();
+	ASSERT_EQ(readers.bad_values, 0);
+	ASSERT_EQ(b.size(), 4096);
+}
+
+TEST(reclamation, readers_during_shrink_to_fit)
+{
+	PayloadReaders readers;
+	PayloadReaders::storage_t b(16);
+	b.enable_deferred_reclamation();
+	PayloadReaders::fill(b, 4096);
+	readers.start(b);
+	for (size_t round = 0; round < 4; ++round)
+	{
+		PayloadReaders::thin_out(b);
+		b.shrink_to_fit();
+		ASSERT_EQ(b.capacity(), 1024);
+		PayloadReaders::fill(b, 3072);
+	}
+	readers.join();
+	ASSERT_EQ(readers.bad_values, 0);
+	ASSERT_EQ(b.size(), 4096);
+
+	BucketStorage< std::unique_ptr< size_t > > move_only;
+	move_only.enable_deferred_reclamation();
+	move_only.insert(std::make_unique< size_t >(1));
+	ASSERT_THROW(move_only.shrink_to_fit(), std::logic_error);
+}
+
+TEST(reclamation, readers_during_merge)
+{
+	PayloadReaders readers;
+	PayloadReaders::storage_t b(16);
+	PayloadReaders::storage_t other(16);
+	other.enable_deferred_reclamation();
+	PayloadReaders::fill(other, 4096);
+	PayloadReaders::thin_out(other);
+	readers.start(other);
+	b.merge(std::move(other));
+	b.clear();
+	readers.join();
+	ASSERT_EQ(readers.bad_values, 0);
+}
+
+TEST(reclamation, readers_during_split)
+{
+	PayloadReaders readers;
+	PayloadReaders::storage_t b(16);
+	b.enable_deferred_reclamation();
+	PayloadReaders::fill(b, 4096);
+	PayloadReaders::thin_out(b);
+	readers.start(b);
+	std::vector< PayloadReaders::storage_t > parts = b.split(2);
+	parts.clear();
+	readers.join();
+	ASSERT_EQ(readers.bad_values, 0);
+	ASSERT_TRUE(b.empty());
+}
+
+TEST(sharded, global_iteration)
+{
+	ShardedBucketStorage< size_t > s(4);
+	std::vector< std::thread > workers;
+	std::atomic< size_t > finished = 0;
+	for (size_t t = 0; t < 4; ++t)
+		workers.emplace_back(
+			[&s, &finished, t]()
+			{
+				for (size_t i = 0; i < 1000; ++i)
+					s.insert(t * 1000 + i);
+				// Exiting gives the shard back, so stay alive until every worker has claimed its own.
+				finished++;
+				while (finished.load() != 4)
+					std::this_thread::yield();
+			});
+	for (std::thread &worker : workers)
+		worker.join();
+
+	ASSERT_EQ(s.size(), 4000);
+	for (size_t i = 0; i < s.shard_count(); ++i)
+		ASSERT_EQ(s.shard(i).size(), 1000);
+
+	std::vector< size_t > seen;
+	for (auto it = s.begin(); it != s.end(); ++it)
+		seen.push_back(*it);
+	std::sort(seen.begin(), seen.end());
+	ASSERT_EQ(seen.size(), 4000);
+	for (size_t i = 0; i < seen.size(); ++i)
+		ASSERT_EQ(seen[i], i);
+}
+
+TEST(sharded, remote_erase)
+{
+	ShardedBucketStorage< size_t > s(2);
+	std::vector< ShardedBucketStorage< size_t >::iterator > local;
+	for (size_t i = 0; i < 100; ++i)
+		local.push_back(s.insert(i));
+
+	std::thread remote(
+		[&s, &local]()
+		{
+			auto own = s.insert(1000);
+			for (size_t i = 0; i < 100; i += 2)
+				s.erase(local[i]);
+			s.erase(own);
+			s.release_local_shard();
+		});
+	remote.join();
+
+	ASSERT_EQ(s.size(), 100);
+	s.drain();
+	ASSERT_EQ(s.size(), 50);
+	for (auto it = s.begin(); it != s.end(); ++it)
+		ASSERT_EQ(*it % 2, 1);
+
+	ASSERT_THROW(ShardedBucketStorage< size_t >(0), std::invalid_argument);
+}
+
+TEST(sharded, thread_exit_releases_shard)
+{
+	ShardedBucketStorage< size_t > s(1);
+	std::vector< ShardedBucketStorage< size_t >::iterator > inserted;
+	std::atomic< int > stage = 0;
+	std::thread worker(
+		[&s, &inserted, &stage]()
+		{
+			for (size_t i = 0; i < 10; ++i)
+				inserted.push_back(s.insert(i));
+			stage = 1;
+			while (stage.load() != 2)
+				std::this_thread::yield();
+		});
+	while (stage.load() != 1)
+		std::this_thread::yield();
+	s.erase(inserted[0]);
+	ASSERT_EQ(s.size(), 10);
+	stage = 2;
+	worker.join();
+
+	ASSERT_EQ(s.size(), 9);
+	ASSERT_EQ(*s.insert(size_t(10)), 10);
+	ASSERT_EQ(s.size(), 10);
+}
+
+TEST(sharded, erase_without_owning_a_shard)
+{
+	ShardedBucketStorage< size_t > s(1);
+	std::vector< ShardedBucketStorage< size_t >::iterator > local;
+	for (size_t i = 0; i < 8; ++i)
+		local.push_back(s.insert(i));
+
+	std::vector< std::thread > erasers;
+	std::atomic< size_t > failures = 0;
+	for (size_t t = 0; t < 4; ++t)
+	{
+		erasers.emplace_back(
+			[&s, &local, &failures, t]()
+			{
+				try
+				{
+					s.erase(local[t]);
+				} catch (const std::overflow_error &)
+				{
+					failures++;
+				}
+			});
+	}
+	for (std::thread &eraser : erasers)
+		eraser.join();
+
+	ASSERT_EQ(failures, 0);
+	s.drain();
+	ASSERT_EQ(s.size(), 4);
+
+	s.release_local_shard();
+	std::thread unowned([&s, &local]() { s.erase(local[4]); });
+	unowned.join();
+	ASSERT_EQ(s.size(), 3);
+}
+
+TEST(hash_map, insert_find_erase)
+{
+	BucketHashMap< size_t, std::string > m;
+	for (size_t i = 0; i < 1000; ++i)
+	{
+		auto inserted = m.insert({ i, std::to_string(i) });
+		ASSERT_TRUE(inserted.second);
+		ASSERT_EQ(inserted.first->second, std::to_string(i));
+	}
+	ASSERT_FALSE(m.insert({ 7, "seven" }).second);
+	ASSERT_EQ(m.size(), 1000);
+	ASSERT_LE(m.load_factor(), m.max_load_factor());
+
+	for (size_t i = 0; i < 1000; ++i)
+		ASSERT_EQ(m.at(i), std::to_string(i));
+	ASSERT_THROW(m.at(1000), std::out_of_range);
+	ASSERT_EQ(m.find(1000), m.end());
+
+	for (size_t i = 0; i < 1000; i += 2)
+		ASSERT_EQ(m.erase(i), 1);
+	ASSERT_EQ(m.erase(0), 0);
+	auto next = m.erase(m.find(1));
+	ASSERT_NE(next, m.find(1));
+	ASSERT_EQ(m.size(), 499);
+
+	m[2] = "two";
+	m[3] += "!";
+	ASSERT_EQ(m.at(2), "two");
+	ASSERT_EQ(m.at(3), "3!");
+
+	size_t visited = 0;
+	for (const auto &entry : std::as_const(m))
+	{
+		ASSERT_TRUE(entry.first == 2 || entry.first % 2 == 1);
+		++visited;
+	}
+	ASSERT_EQ(visited, m.size());
+	ASSERT_EQ(std::next(m.find(m.begin()->first), static_cast< std::ptrdiff_t >(m.size())), m.end());
+	ASSERT_THROW(*m.end(), std::out_of_range);
+	ASSERT_THROW(++m.end(), std::out_of_range);
+
+	BucketHashMap< size_t, std::string > copy = m;
+	m.clear();
+	ASSERT_TRUE(m.empty());
+	ASSERT_FALSE(m.contains(3));
+	ASSERT_EQ(copy.size(), 500);
+	ASSERT_EQ(copy.at(3), "3!");
+}
+
+TEST(hash_map, stable_across_rehash)
+{
+	BucketHashMap< size_t, size_t > m;
+	std::vector< std::pair< const size_t, size_t > * > addresses;
+	for (size_t i = 0; i < 100; ++i)
+		addresses.push_back(&*m.try_emplace(i, i * i).first);
+
+	size_t buckets = m.bucket_count();
+	m.reserve(100000);
+	ASSERT_GT(m.bucket_count(), buckets);
+	for (size_t i = 100; i < 5000; ++i)
+		m[i] = i * i;
+
+	for (size_t i = 0; i < 100; ++i)
+	{
+		ASSERT_EQ(addresses[i], &*m.find(i));
+		ASSERT_EQ(addresses[i]->second, i * i);
+	}
+}
+
+TEST(lru, eviction_order)
+{
+	BucketLRU< size_t, std::string > cache(3);
+	ASSERT_THROW((BucketLRU< size_t, std::string >(0)), std::invalid_argument);
+
+	cache.put(1, "one");
+	cache.put(2, "two");
+	cache.put(3, "three");
+	ASSERT_EQ(*cache.get(1), "one");
+	cache.put(4, "four");
+	ASSERT_EQ(cache.size(), 3);
+	ASSERT_FALSE(cache.contains(2));
+	ASSERT_EQ(cache.get(2), nullptr);
+
+	cache.put(3, "THREE");
+	std::vector< size_t > order;
+	cache.for_each([&order](const size_t &key, const std::string &) { order.push_back(key); });
+	ASSERT_EQ(order, (std::vector< size_t >{ 3, 4, 1 }));
+	ASSERT_EQ(*cache.get(3), "THREE");
+
+	ASSERT_TRUE(cache.erase(4));
+	ASSERT_FALSE(cache.erase(4));
+	ASSERT_EQ(cache.size(), 2);
+	ASSERT_EQ(cache.hits(), 2);
+	ASSERT_EQ(cache.misses(), 1);
+
+	cache.clear();
+	ASSERT_TRUE(cache.empty());
+	ASSERT_EQ(cache.get(1), nullptr);
+}
+
+TEST(lru, recycles_evicted_slot)
+{
+	BucketLRU< size_t, size_t > cache(64);
+	std::vector< size_t * > values;
+	for (size_t i = 0; i < 64; ++i)
+		values.push_back(&cache.put(i, i));
+
+	for (size_t i = 64; i < 1000; ++i)
+	{
+		size_t *value = &cache.put(i, i);
+		ASSERT_EQ(value, values[i % 64]);
+		ASSERT_FALSE(cache.contains(i - 64));
+		ASSERT_EQ(*cache.get(i), i);
+	}
+	ASSERT_EQ(cache.size(), 64);
+}
+
+TEST(inplace, insert_erase_iterate)
+{
+	InplaceBucketStorage< size_t, 4, 3 > storage;
+	ASSERT_EQ(storage.capacity(), 12);
+	std::vector< InplaceBucketStorage< size_t, 4, 3 >::iterator > positions;
+	for (size_t i = 0; i < 12; ++i)
+		positions.push_back(storage.insert(i));
+	ASSERT_TRUE(storage.full());
+	ASSERT_EQ(storage.insert(size_t(100)), storage.end());
+	ASSERT_EQ(storage.size(), 12);
+
+	size_t expected = 0;
+	for (size_t value : storage)
+		ASSERT_EQ(value, expected++);
+
+	auto next = storage.erase(positions[3]);
+	ASSERT_EQ(*next, 4);
+	next = storage.erase(positions[11]);
+	ASSERT_EQ(next, storage.end());
+	ASSERT_EQ(*--next, 10);
+	for (size_t i = 4; i < 8; ++i)
+		storage.erase(positions[i]);
+	ASSERT_EQ(*++positions[2], 8);
+	ASSERT_EQ(*--positions[8], 2);
+
+	auto reused = storage.insert(size_t(42));
+	ASSERT_EQ(reused, positions[7]);
+	ASSERT_EQ(storage.size(), 7);
+
+	InplaceBucketStorage< size_t, 4, 3 > copy(storage);
+	ASSERT_TRUE(std::equal(copy.begin(), copy.end(), storage.begin(), storage.end()));
+	storage.clear();
+	ASSERT_TRUE(storage.empty());
+	ASSERT_EQ(storage.begin(), storage.end());
+	ASSERT_THROW(*storage.begin(), std::out_of_range);
+}
+
+TEST(inplace, no_heap_allocations)
+{
+	size_t before = heapAllocations.load();
+	{
+		InplaceBucketStorage< CountedOperationObject, 16, 8 > storage;
+		for (size_t round = 0; round < 4; ++round)
+		{
+			while (storage.insert(CountedOperationObject(round)) != storage.end())
+			{
+			}
+			ASSERT_EQ(storage.size(), storage.capacity());
+			size_t sum = 0;
+			for (auto it = storage.cbegin(); it != storage.cend(); ++it)
+				sum += it->number;
+			ASSERT_EQ(sum, round * storage.capacity());
+			for (auto it = storage.begin(); it != storage.end();)
+				it = storage.erase(it);
+			ASSERT_TRUE(storage.empty());
+		}
+		storage.emplace(size_t(7));
+		InplaceBucketStorage< CountedOperationObject, 16, 8 > moved(std::move(storage));
+		ASSERT_EQ(moved.begin()->number, 7);
+	}
+	ASSERT_EQ(heapAllocations.load(), before);
+}
+
+TEST(sort, matches_std_sort)
+{
+	BucketStorage< size_t > storage(16, 256);
+	std::vector< size_t > expected;
+	std::mt19937_64 generator(7);
+	for (size_t i = 0; i < 5000; ++i)
+	{
+		size_t value = generator() % 1000;
+		storage.insert(value);
+		expected.push_back(value);
+	}
+	for (auto it = storage.begin(); it != storage.end();)
+	{
+		if (*it % 7 == 0)
+		{
+			expected.erase(std::find(expected.begin(), expected.end(), *it));
+			it = storage.erase(it);
+		}
+		else
+			++it;
+	}
+	BucketStorage< size_t > snapshot = storage;
+
+	storage.sort(std::greater< size_t >(), false, 4);
+	std::sort(expected.begin(), expected.end(), std::greater< size_t >());
+	ASSERT_TRUE(std::equal(storage.begin(), storage.end(), expected.begin(), expected.end()));
+	ASSERT_EQ(storage.size(), expected.size());
+
+	sort(snapshot);
+	std::reverse(expected.begin(), expected.end());
+	ASSERT_TRUE(std::equal(snapshot.begin(), snapshot.end(), expected.begin(), expected.end()));
+}
+
+TEST(sort, stable_keeps_equal_order)
+{
+	BucketStorage< std::pair< size_t, size_t > > storage(8);
+	for (size_t i = 0; i < 1000; ++i)
+		storage.insert({ (i * 37) % 10, i });
+	auto by_key = [](const std::pair< size_t, size_t > &lhs, const std::pair< size_t, size_t > &rhs)
+	{ return lhs.first < rhs.first; };
+	storage.sort(by_key, true, 3);
+
+	auto previous = storage.begin();
+	for (auto it = std::next(previous); it != storage.end(); previous = it++)
+	{
+		ASSERT_LE(previous->first, it->first);
+		if (previous->first == it->first)
+		{
+			ASSERT_LT(previous->second, it->second);
+		}
+	}
+	ASSERT_EQ(storage.size(), 1000);
+}
+
+TEST(sort, skips_tombstones)
+{
+	BucketStorage< size_t > storage(16);
+	std::vector< size_t > expected;
+	for (size_t i = 0; i < 1000; ++i)
+	{
+		auto it = storage.insert((i * 7919) % 1000);
+		if (i % 5 == 0)
+			storage.mark_erased(it);
+		else
+			expected.push_back((i * 7919) % 1000);
+	}
+	storage.sort(std::less< size_t >(), false, 2);
+	std::sort(expected.begin(), expected.end());
+	ASSERT_TRUE(std::equal(storage.begin(), storage.end(), expected.begin(), expected.end()));
+
+	storage.compact();
+	ASSERT_TRUE(std::equal(storage.begin(), storage.end(), expected.begin(), expected.end()));
+}
+
+struct RelocatableHandle
+{
+	std::unique_ptr< size_t > value;
+	explicit RelocatableHandle(size_t number) : value(std::make_unique< size_t >(number)) {}
+	RelocatableHandle(const RelocatableHandle &other) : value(std::make_unique< size_t >(*other.value)) {}
+	RelocatableHandle(RelocatableHandle &&other) noexcept = default;
+};
+
+template<>
+struct is_trivially_relocatable< RelocatableHandle > : std::true_type
+{
+};
+
+TEST(relocation, shrink_to_fit_relocates_runs)
+{
+	static_assert(is_trivially_relocatable_v< size_t >);
+	static_assert(!is_trivially_relocatable_v< std::string >);
+
+	BucketStorage< RelocatableHandle > storage(8);
+	std::vector< BucketStorage< RelocatableHandle >::iterator > positions;
+	for (size_t i = 0; i < 100; ++i)
+		positions.push_back(storage.emplace(i));
+	for (size_t i = 0; i < 100; i += 3)
+		storage.erase(positions[i]);
+	storage.mark_erased(positions[1]);
+	size_t capacity_before = storage.capacity();
+
+	storage.shrink_to_fit();
+	ASSERT_LT(storage.capacity(), capacity_before);
+	ASSERT_EQ(storage.size(), 65);
+	size_t expected = 2;
+	for (const RelocatableHandle &handle : storage)
+	{
+		if (expected % 3 == 0)
+			++expected;
+		ASSERT_EQ(*handle.value, expected++);
+	}
+}
+
+TEST(relocation, defragment_after_copy)
+{
+	BucketStorage< size_t > storage(16);
+	std::vector< BucketStorage< size_t >::iterator > positions;
+	for (size_t i = 0; i < 160; ++i)
+		positions.push_back(storage.insert(i));
+	for (size_t i = 0; i < 160; ++i)
+	{
+		if (i % 16 >= 4)
+			storage.erase(positions[i]);
+	}
+	BucketStorage< size_t > copy = storage;
+	copy.insert(size_t(1000));
+	while (!storage.defragment_step(64).done)
+	{
+	}
+
+	std::vector< size_t > values(storage.begin(), storage.end());
+	std::vector< size_t > copied(copy.begin(), copy.end());
+	std::sort(values.begin(), values.end());
+	std::sort(copied.begin(), copied.end());
+	ASSERT_EQ(values.size(), 40);
+	ASSERT_EQ(copied.size(), 41);
+	ASSERT_TRUE(std::equal(values.begin(), values.end(), copied.begin()));
+	ASSERT_EQ(copied.back(), 1000);
+	ASSERT_EQ(storage.capacity(), 48);
+}
+
+TEST(teardown, clear_releases_whole_blocks)
+{
+	BucketStorage< size_t > storage(16);
+	for (size_t i = 0; i < 1000; ++i)
+		storage.insert(i);
+	BucketStorage< size_t > shared = storage;
+	storage.clear();
+	ASSERT_TRUE(storage.empty());
+	ASSERT_EQ(storage.capacity(), 0);
+	ASSERT_EQ(shared.size(), 1000);
+	ASSERT_EQ(std::accumulate(shared.begin(), shared.end(), size_t(0)), 999 * 1000 / 2);
+
+	storage = std::move(shared);
+	storage.insert(size_t(5));
+	ASSERT_EQ(storage.size(), 1001);
+
+	auto counted = prepare();
+	counted.clear();
+	ASSERT_EQ(opCount.dtorCount, 1000);
+}
+
+struct Position
+{
+	float x, y;
+};
+
+struct Velocity
+{
+	float dx, dy;
+};
+
+TEST(archetype, query_streams_matching_columns)
+{
+	ArchetypeStorage< Position, Velocity, std::string > world(16);
+	std::vector< ArchetypeStorage< Position, Velocity, std::string >::Entity > entities;
+	for (size_t i = 0; i < 100; ++i)
+	{
+		float f = static_cast< float >(i);
+		entities.push_back(world.insert(Position{ f, 0 }, Velocity{ 1, f }, std::to_string(i)));
+	}
+	ASSERT_EQ(world.size(), 100);
+	ASSERT_EQ(world.capacity(), 112);
+
+	world.for_each< Position, Velocity >(
+		[](Position &position, const Velocity &velocity)
+		{
+			position.x += velocity.dx;
+			position.y += velocity.dy;
+		});
+	ASSERT_EQ(world.get< Position >(entities[42]).x, 43);
+	ASSERT_EQ(world.get< Position >(entities[42]).y, 42);
+	ASSERT_EQ(world.get< std::string >(entities[42]), "42");
+
+	for (size_t i = 0; i < 100; i += 2)
+		world.erase(entities[i]);
+	ASSERT_FALSE(world.contains(entities[0]));
+	ASSERT_THROW(world.erase(entities[0]), std::invalid_argument);
+	ASSERT_THROW(world.get< Position >(entities[0]), std::out_of_range);
+
+	size_t visited = 0;
+	const auto &view = world;
+	view.for_each< std::string >([&visited](const std::string &name) { visited += std::stoul(name) % 2; });
+	ASSERT_EQ(visited, 50);
+
+	auto reused = world.insert(Position{ 0, 0 }, Velocity{ 0, 0 }, std::string("new"));
+	ASSERT_EQ(reused.chunk, entities[94].chunk);
+	ASSERT_EQ(reused.slot, entities[94].slot);
+	ASSERT_NE(reused, entities[94]);
+	ASSERT_TRUE(world.contains(reused));
+	ASSERT_FALSE(world.contains(entities[94]));
+	ASSERT_THROW(world.get< std::string >(entities[94]), std::out_of_range);
+
+	for (size_t i = 1; i < 16; i += 2)
+		world.erase(entities[i]);
+	ASSERT_EQ(world.capacity(), 96);
+	ASSERT_FALSE(world.contains(entities[1]));
+	ASSERT_THROW(world.erase(entities[1]), std::invalid_argument);
+	auto refilled = world.insert(Position{ 0, 0 }, Velocity{ 0, 0 }, std::string("refilled"));
+	ASSERT_EQ(world.get< std::string >(refilled), "refilled");
+	ASSERT_FALSE(world.contains(entities[1]));
+	world.clear();
+	ASSERT_TRUE(world.empty());
+	ASSERT_EQ(world.capacity(), 0);
+}
+
 int main(int argc, char **argv)
 {
 	::testing::InitGoogleTest();
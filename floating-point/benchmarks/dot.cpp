@@ -0,0 +1,273 @@
+// Dot-product kernels against the same reductions evaluated with hardware arithmetic under fesetround.
+//
+// Build: gcc -std=c17 -O2 -c ../softfloat.c ../softfloat_dot.c &&
+//        g++ -std=c++20 -O2 -frounding-math -pthread -I.. dot.cpp softfloat.o softfloat_dot.o -o dot
+// Usage: ./dot [rows] [length] [block] [threads]
+//
+// Every accumulator, rounding mode, reduction order and fused setting is checked row by row. Half products and sums
+// are exact in binary64 and rounded once to _Float16; single ones use binary32 arithmetic and std::fma. A fused half
+// step rounds the binary64 sum to odd first, which keeps the final rounding to half correct. Any two NaNs compare
+// equal. Inputs are random halves of moderate magnitude with some zeros, subnormals and infinities mixed in.
+
+#include "softfloat.h"
+
+#include <algorithm>
+#include <cfenv>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#ifndef __FLT16_MAX__
+#error "dot needs a compiler with _Float16 support (GCC 12+ or Clang 15+ on x86-64/AArch64)"
+#endif
+
+static const int hardware_modes[4] = { FE_TOWARDZERO, FE_TONEAREST, FE_UPWARD, FE_DOWNWARD };
+static const char *const order_names[3] = { "sequential", "pairwise", "blocked" };
+
+static double half_to_double(uint16_t bits)
+{
+	int exponent = (bits >> 10) & 0x1f;
+	int mantissa = bits & 0x3ff;
+	double magnitude;
+	if (exponent == 0x1f)
+		magnitude = mantissa ? NAN : INFINITY;
+	else if (exponent == 0)
+		magnitude = std::ldexp(mantissa, -24);
+	else
+		magnitude = std::ldexp(mantissa | 0x400, exponent - 25);
+	return bits >> 15 ? -magnitude : magnitude;
+}
+
+template< typename T >
+static uint32_t to_bits(T value)
+{
+	if constexpr (std::is_same_v< T, float >)
+	{
+		uint32_t bits;
+		std::memcpy(&bits, &value, sizeof(bits));
+		return bits;
+	}
+	else
+	{
+		uint16_t bits;
+		std::memcpy(&bits, &value, sizeof(bits));
+		return bits;
+	}
+}
+
+static bool is_nan(uint32_t bits, bool single)
+{
+	return single ? (bits & 0x7f800000) == 0x7f800000 && (bits & 0x007fffff) != 0
+				  : (bits & 0x7c00) == 0x7c00 && (bits & 0x03ff) != 0;
+}
+
+template< typename T >
+struct HardwareDot
+{
+	int mode;
+	bool fused;
+	sf_order order;
+	size_t block;
+
+	T product(uint16_t a, uint16_t b) const
+	{
+		volatile double exact = half_to_double(a) * half_to_double(b);
+		return static_cast< T >(exact);
+	}
+
+	T add(T x, T y) const
+	{
+		if constexpr (std::is_same_v< T, float >)
+		{
+			volatile float x_copy = x, y_copy = y;
+			return x_copy + y_copy;
+		}
+		else
+		{
+			volatile double exact = static_cast< double >(x) + static_cast< double >(y);
+			return static_cast< T >(exact);
+		}
+	}
+
+	T fma(uint16_t a, uint16_t b, T sum) const
+	{
+		if constexpr (std::is_same_v< T, float >)
+		{
+			volatile float x = static_cast< float >(half_to_double(a)), y = static_cast< float >(half_to_double(b));
+			return std::fma(static_cast< float >(x), static_cast< float >(y), sum);
+		}
+		else
+		{
+			volatile double exact_product = half_to_double(a) * half_to_double(b), addend = sum;
+			std::fesetround(FE_TOWARDZERO);
+			std::feclearexcept(FE_INEXACT);
+			volatile double truncated = exact_product + addend;
+			bool inexact = std::fetestexcept(FE_INEXACT);
+			std::fesetround(hardware_modes[mode]);
+			if (!inexact)
+			{
+				volatile double exact = exact_product + addend;
+				return static_cast< T >(exact);
+			}
+			double odd = truncated;
+			if (std::isfinite(odd))
+			{
+				uint64_t bits;
+				std::memcpy(&bits, &odd, sizeof(bits));
+				bits |= 1;
+				std::memcpy(&odd, &bits, sizeof(bits));
+			}
+			return static_cast< T >(odd);
+		}
+	}
+
+	T sequential(const uint16_t *a, const uint16_t *b, size_t begin, size_t end) const
+	{
+		T sum = 0;
+		for (size_t i = begin; i < end; ++i)
+			sum = fused ? fma(a[i], b[i], sum) : add(sum, product(a[i], b[i]));
+		return sum;
+	}
+
+	T pairwise(const uint16_t *a, const uint16_t *b, size_t begin, size_t end) const
+	{
+		if (end - begin == 1)
+			return product(a[begin], b[begin]);
+		size_t middle = begin + (end - begin) / 2;
+		return add(pairwise(a, b, begin, middle), pairwise(a, b, middle, end));
+	}
+
+	T dot(const uint16_t *a, const uint16_t *b, size_t length) const
+	{
+		if (order == SF_ORDER_PAIRWISE)
+			return pairwise(a, b, 0, length);
+		if (order == SF_ORDER_SEQUENTIAL || block == 0)
+			return sequential(a, b, 0, length);
+		T sum = 0;
+		for (size_t begin = 0; begin < length; begin += block)
+			sum = add(sum, sequential(a, b, begin, std::min(length, begin + block)));
+		return sum;
+	}
+};
+
+static uint16_t random_half(std::mt19937_64 &generator)
+{
+	uint64_t bits = generator();
+	uint16_t sign = static_cast< uint16_t >((bits >> 16) & 0x8000);
+	uint64_t kind = bits % 0x10000;
+	if (kind == 0)
+		return sign | 0x7c00;
+	if (kind < 0x800)
+		return sign;
+	if (kind < 0x1000)
+		return static_cast< uint16_t >(sign | ((bits >> 32) & 0x3ff) | 1);
+	// Exponents 2^-10 .. 2^3 keep most sums finite in half precision.
+	uint16_t exponent = static_cast< uint16_t >(5 + (bits >> 42) % 14);
+	return static_cast< uint16_t >(sign | exponent << 10 | ((bits >> 32) & 0x3ff));
+}
+
+template< typename T >
+static uint64_t check(const std::vector< uint16_t > &a,
+					  const std::vector< uint16_t > &b,
+					  const std::vector< uint32_t > &out,
+					  size_t rows,
+					  size_t length,
+					  const HardwareDot< T > &reference,
+					  size_t &finite)
+{
+	uint64_t mismatches = 0;
+	std::fesetround(hardware_modes[reference.mode]);
+	for (size_t row = 0; row < rows; ++row)
+	{
+		T result = reference.dot(a.data() + row * length, b.data() + row * length, length);
+		uint32_t expected = to_bits(result);
+		bool single = std::is_same_v< T, float >;
+		finite += std::isfinite(static_cast< double >(result));
+		if (out[row] != expected && !(is_nan(out[row], single) && is_nan(expected, single)) && mismatches++ < 4)
+			std::printf("row %zu: emulated %08x, hardware %08x\n", row, out[row], expected);
+	}
+	std::fesetround(FE_TONEAREST);
+	return mismatches;
+}
+
+int main(int argc, char **argv)
+{
+	size_t rows = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 2048;
+	size_t length = argc > 2 ? std::max(1ull, std::strtoull(argv[2], nullptr, 10)) : 1000;
+	size_t block = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 64;
+	unsigned threads = argc > 4 ? static_cast< unsigned >(std::strtoul(argv[4], nullptr, 10)) : 0;
+	if (threads == 0)
+		threads = std::max(1u, std::thread::hardware_concurrency());
+
+	std::mt19937_64 generator(42);
+	std::vector< uint16_t > a(rows * length), b(rows * length);
+	for (size_t i = 0; i < a.size(); ++i)
+	{
+		a[i] = random_half(generator);
+		b[i] = random_half(generator);
+	}
+	std::vector< uint32_t > out(rows);
+
+	uint64_t total_mismatches = 0;
+	std::printf("acc r order      fused  ns/term  finite rows  mismatches\n");
+	for (int single = 0; single < 2; ++single)
+	{
+		for (int mode = 0; mode < 4; ++mode)
+		{
+			for (int order = 0; order < 3; ++order)
+			{
+				for (int fused = 0; fused < 2; ++fused)
+				{
+					if (fused && order == SF_ORDER_PAIRWISE)
+						continue;
+					sf_dot_options options;
+					options.accumulator = single ? &sf_single_consts : &sf_half_consts;
+					options.round_num = static_cast< sf_rounding >(mode);
+					options.order = static_cast< sf_order >(order);
+					options.block = block;
+					options.fused = fused;
+
+					auto start = std::chrono::steady_clock::now();
+					sf_h_dot_rows(a.data(), b.data(), length, rows, length, out.data(), &options, threads);
+					auto stop = std::chrono::steady_clock::now();
+					double ns = std::chrono::duration< double, std::nano >(stop - start).count() / (rows * length);
+
+					uint64_t mismatches;
+					size_t finite = 0;
+					if (single)
+					{
+						HardwareDot< float > reference{ mode, fused != 0, options.order, block };
+						mismatches = check(a, b, out, rows, length, reference, finite);
+					}
+					else
+					{
+						HardwareDot< _Float16 > reference{ mode, fused != 0, options.order, block };
+						mismatches = check(a, b, out, rows, length, reference, finite);
+					}
+					total_mismatches += mismatches;
+					std::printf("%c   %d %-10s %-5s %8.2f  %11zu  %llu\n",
+								single ? 'f' : 'h',
+								mode,
+								order_names[order],
+								fused ? "yes" : "no",
+								ns,
+								finite,
+								static_cast< unsigned long long >(mismatches));
+				}
+			}
+		}
+	}
+	std::printf("\n%zu rows of %zu terms on %u threads, %llu mismatches\n",
+				rows,
+				length,
+				threads,
+				static_cast< unsigned long long >(total_mismatches));
+	return total_mismatches == 0 ? 0 : 1;
+}
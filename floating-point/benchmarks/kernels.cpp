@@ -0,0 +1,108 @@
+// softfloat.hpp kernels specialised per format and rounding mode against the runtime-dispatched C library.
+//
+// Build: gcc -std=c17 -O2 -c ../softfloat.c && g++ -std=c++20 -O2 -I.. kernels.cpp softfloat.o -o kernels
+// Usage: ./kernels [operations]
+//
+// Operands are uniformly random bit patterns, so every class (normal, subnormal, zero, infinity, NaN) shows up in
+// its natural proportion. Every templated result is compared against the C library.
+
+#include "softfloat.h"
+#include "softfloat.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <utility>
+#include <vector>
+
+using softfloat::Half;
+using softfloat::Rounding;
+using softfloat::Single;
+
+template< typename F >
+struct Runtime;
+
+template<>
+struct Runtime< Half >
+{
+	static constexpr const char *name = "half";
+	using Operation = uint16_t (*)(uint16_t, uint16_t, sf_rounding);
+	static constexpr Operation operations[4] = { sf_h_add, sf_h_sub, sf_h_mul, sf_h_div };
+};
+
+template<>
+struct Runtime< Single >
+{
+	static constexpr const char *name = "single";
+	using Operation = uint32_t (*)(uint32_t, uint32_t, sf_rounding);
+	static constexpr Operation operations[4] = { sf_f_add, sf_f_sub, sf_f_mul, sf_f_div };
+};
+
+static const char *const operation_names[4] = { "add", "sub", "mul", "div" };
+
+template< typename F, Rounding R, size_t Op >
+static typename F::Bits specialised(typename F::Bits a, typename F::Bits b)
+{
+	if constexpr (Op == 0)
+		return softfloat::add< F, R >(a, b);
+	else if constexpr (Op == 1)
+		return softfloat::sub< F, R >(a, b);
+	else if constexpr (Op == 2)
+		return softfloat::mul< F, R >(a, b);
+	else
+		return softfloat::div< F, R >(a, b);
+}
+
+template< typename F, Rounding R, size_t Op >
+static void run_case(const std::vector< typename F::Bits > &a, const std::vector< typename F::Bits > &b)
+{
+	using Bits = typename F::Bits;
+	std::vector< Bits > expected(a.size()), actual(a.size());
+	volatile uint8_t mode = static_cast< uint8_t >(R);
+
+	auto start = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < a.size(); ++i)
+		expected[i] = Runtime< F >::operations[Op](a[i], b[i], static_cast< sf_rounding >(mode));
+	auto middle = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < a.size(); ++i)
+		actual[i] = specialised< F, R, Op >(a[i], b[i]);
+	auto stop = std::chrono::steady_clock::now();
+
+	size_t mismatches = 0;
+	for (size_t i = 0; i < a.size(); ++i)
+		mismatches += expected[i] != actual[i];
+	double count = static_cast< double >(a.size());
+	double runtime_ns = std::chrono::duration< double, std::nano >(middle - start).count() / count;
+	double specialised_ns = std::chrono::duration< double, std::nano >(stop - middle).count() / count;
+	std::cout << std::setw(6) << Runtime< F >::name << ' ' << static_cast< int >(R) << ' ' << operation_names[Op]
+			  << std::fixed << std::setprecision(2) << std::setw(10) << runtime_ns << std::setw(13) << specialised_ns
+			  << std::setw(9) << runtime_ns / specialised_ns << 'x' << std::setw(12) << mismatches << '\n';
+}
+
+template< typename F >
+static void run_format(size_t count, std::mt19937_64 &generator)
+{
+	using Bits = typename F::Bits;
+	std::vector< Bits > a(count), b(count);
+	for (size_t i = 0; i < count; ++i)
+	{
+		a[i] = static_cast< Bits >(generator());
+		b[i] = static_cast< Bits >(generator());
+	}
+	[&]< size_t... I >(std::index_sequence< I... >)
+	{
+		(run_case< F, static_cast< Rounding >(I / 4), I % 4 >(a, b), ...);
+	}(std::make_index_sequence< 16 >());
+}
+
+int main(int argc, char **argv)
+{
+	size_t count = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : size_t(1) << 22;
+	std::mt19937_64 generator(42);
+	std::cout << "format r op  runtime ns  template ns  speedup  mismatches\n";
+	run_format< Half >(count, generator);
+	run_format< Single >(count, generator);
+	return 0;
+}
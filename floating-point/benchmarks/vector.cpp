@@ -0,0 +1,109 @@
+// SIMD half-precision array kernels against the scalar library: bit-identity and throughput.
+//
+// Build: gcc -std=c17 -O2 -march=native -c ../softfloat.c ../softfloat_simd.c &&
+//        g++ -std=c++20 -O2 -I.. vector.cpp softfloat.o softfloat_simd.o -o vector
+// Usage: ./vector [first operand stride] [operations]
+//
+// The check runs every second operand against one first operand per stride (stride 1 covers all 2^32 pairs) in all
+// four rounding modes. Array lengths are not a multiple of the lane count, so the tail path is exercised too.
+
+#include "softfloat.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+using Scalar = uint16_t (*)(uint16_t, uint16_t, sf_rounding);
+using Array = void (*)(const uint16_t *, const uint16_t *, uint16_t *, size_t, sf_rounding);
+
+static const char *const operation_names[3] = { "add", "sub", "mul" };
+static const Scalar scalar_operations[3] = { sf_h_add, sf_h_sub, sf_h_mul };
+static const Array array_operations[3] = { sf_h_add_array, sf_h_sub_array, sf_h_mul_array };
+
+static uint64_t check(size_t stride)
+{
+	const size_t length = 0x10000 + 5;
+	std::vector< uint16_t > a(length), b(length), expected(length), actual(length);
+	for (size_t i = 0; i < length; ++i)
+		b[i] = static_cast< uint16_t >(i);
+
+	uint64_t mismatches = 0;
+	for (uint32_t first = 0; first <= 0xffff; first += static_cast< uint32_t >(stride))
+	{
+		std::fill(a.begin(), a.end(), static_cast< uint16_t >(first));
+		for (int mode = 0; mode < 4; ++mode)
+		{
+			for (int operation = 0; operation < 3; ++operation)
+			{
+				sf_rounding round_num = static_cast< sf_rounding >(mode);
+				for (size_t i = 0; i < length; ++i)
+					expected[i] = scalar_operations[operation](a[i], b[i], round_num);
+				array_operations[operation](a.data(), b.data(), actual.data(), length, round_num);
+				for (size_t i = 0; i < length; ++i)
+				{
+					if (expected[i] == actual[i])
+						continue;
+					if (mismatches++ < 8)
+						std::printf("h %d %04x %s %04x: scalar %04x, array %04x\n",
+									mode,
+									a[i],
+									operation_names[operation],
+									b[i],
+									expected[i],
+									actual[i]);
+				}
+			}
+		}
+	}
+	return mismatches;
+}
+
+static void benchmark(size_t count)
+{
+	std::mt19937_64 generator(42);
+	std::vector< uint16_t > a(count), b(count), out(count);
+	for (size_t i = 0; i < count; ++i)
+	{
+		a[i] = static_cast< uint16_t >(generator());
+		b[i] = static_cast< uint16_t >(generator());
+	}
+
+	std::printf("r op   scalar ns  array ns  speedup\n");
+	for (int mode = 0; mode < 4; ++mode)
+	{
+		for (int operation = 0; operation < 3; ++operation)
+		{
+			volatile int runtime_mode = mode;
+			sf_rounding round_num = static_cast< sf_rounding >(runtime_mode);
+			auto start = std::chrono::steady_clock::now();
+			for (size_t i = 0; i < count; ++i)
+				out[i] = scalar_operations[operation](a[i], b[i], round_num);
+			auto middle = std::chrono::steady_clock::now();
+			array_operations[operation](a.data(), b.data(), out.data(), count, round_num);
+			auto stop = std::chrono::steady_clock::now();
+
+			double scalar_ns = std::chrono::duration< double, std::nano >(middle - start).count() / count;
+			double array_ns = std::chrono::duration< double, std::nano >(stop - middle).count() / count;
+			std::printf("%d %s %10.2f %9.2f %7.1fx\n",
+						mode,
+						operation_names[operation],
+						scalar_ns,
+						array_ns,
+						scalar_ns / array_ns);
+		}
+	}
+}
+
+int main(int argc, char **argv)
+{
+	size_t stride = argc > 1 ? std::max(1ull, std::strtoull(argv[1], nullptr, 10)) : 1;
+	size_t count = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : size_t(1) << 24;
+
+	benchmark(count);
+	uint64_t mismatches = check(stride);
+	std::printf("\n%llu mismatches\n", static_cast< unsigned long long >(mismatches));
+	return mismatches == 0 ? 0 : 1;
+}
@@ -0,0 +1,356 @@
+// Exhaustive check of the softfloat library against hardware arithmetic in all four rounding modes.
+//
+// Build: gcc -std=c17 -O2 -c ../softfloat.c &&
+//        g++ -std=c++20 -O2 -frounding-math -pthread -I.. verify.cpp softfloat.o -o verify
+// Usage: ./verify [threads] [half operand stride] [single samples per mode] [fma samples per mode and format]
+//
+// Half precision: every pair of operands (one first operand per stride) for +, -, *, /. The hardware reference
+// computes in binary64, where sums and products of halves are exact and quotients are rounded innocuously, and
+// converts to _Float16 under fesetround. Single precision: random operand pairs against binary32 arithmetic under
+// fesetround. Fused multiply-add: random triples, a quarter of them with an addend close to -a*b so that the sum
+// cancels. Half uses the exact binary64 product plus the addend rounded to odd, single uses std::fma. Any two NaNs
+// compare equal.
+
+#include "softfloat.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cfenv>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+#ifndef __FLT16_MAX__
+#error "verify needs a compiler with _Float16 support (GCC 12+ or Clang 15+ on x86-64/AArch64)"
+#endif
+
+static const int hardware_modes[4] = { FE_TOWARDZERO, FE_TONEAREST, FE_UPWARD, FE_DOWNWARD };
+static const char operation_signs[5] = { '+', '-', '*', '/', 'f' };
+static const size_t REPORTED_PER_CASE = 4;
+
+struct Report
+{
+	std::atomic< uint64_t > mismatches[2][4][5] = {};
+	std::atomic< uint64_t > checked[2] = {};
+	std::mutex output;
+
+	void mismatch(int format,
+				  int mode,
+				  int operation,
+				  uint32_t a,
+				  uint32_t b,
+				  uint32_t emulated,
+				  uint32_t hardware,
+				  uint32_t c = 0)
+	{
+		if (mismatches[format][mode][operation]++ >= REPORTED_PER_CASE)
+			return;
+		std::lock_guard< std::mutex > lock(output);
+		const char *width = format == 0 ? "%04x" : "%08x";
+		std::printf("%c %d ", format == 0 ? 'h' : 'f', mode);
+		std::printf(width, a);
+		std::printf(" %c ", operation_signs[operation]);
+		std::printf(width, b);
+		if (operation == 4)
+		{
+			std::printf(" ");
+			std::printf(width, c);
+		}
+		std::printf(": emulated ");
+		std::printf(width, emulated);
+		std::printf(", hardware ");
+		std::printf(width, hardware);
+		std::printf("\n");
+	}
+};
+
+static bool is_nan(uint32_t bits, int format)
+{
+	return format == 0 ? (bits & 0x7c00) == 0x7c00 && (bits & 0x03ff) != 0
+					   : (bits & 0x7f800000) == 0x7f800000 && (bits & 0x007fffff) != 0;
+}
+
+static double half_to_double(uint16_t bits)
+{
+	int exponent = (bits >> 10) & 0x1f;
+	int mantissa = bits & 0x3ff;
+	double magnitude;
+	if (exponent == 0x1f)
+		magnitude = mantissa ? NAN : INFINITY;
+	else if (exponent == 0)
+		magnitude = std::ldexp(mantissa, -24);
+	else
+		magnitude = std::ldexp(mantissa | 0x400, exponent - 25);
+	return bits >> 15 ? -magnitude : magnitude;
+}
+
+static uint16_t hardware_half(double a, double b, int operation)
+{
+	volatile double x = a, y = b;
+	double result;
+	switch (operation)
+	{
+	case 0:
+		result = x + y;
+		break;
+	case 1:
+		result = x - y;
+		break;
+	case 2:
+		result = x * y;
+		break;
+	default:
+		result = x / y;
+		break;
+	}
+	volatile _Float16 rounded = static_cast< _Float16 >(result);
+	_Float16 copy = rounded;
+	uint16_t bits;
+	std::memcpy(&bits, &copy, sizeof(bits));
+	return bits;
+}
+
+static uint32_t hardware_single(uint32_t a, uint32_t b, int operation)
+{
+	float fa, fb;
+	std::memcpy(&fa, &a, sizeof(fa));
+	std::memcpy(&fb, &b, sizeof(fb));
+	volatile float x = fa, y = fb;
+	float result;
+	switch (operation)
+	{
+	case 0:
+		result = x + y;
+		break;
+	case 1:
+		result = x - y;
+		break;
+	case 2:
+		result = x * y;
+		break;
+	default:
+		result = x / y;
+		break;
+	}
+	uint32_t bits;
+	std::memcpy(&bits, &result, sizeof(bits));
+	return bits;
+}
+
+static void check_half(Report &report, int mode, uint16_t a)
+{
+	static uint16_t (*const emulated[4])(uint16_t, uint16_t, sf_rounding) = { sf_h_add, sf_h_sub, sf_h_mul, sf_h_div };
+	double da = half_to_double(a);
+	for (uint32_t b = 0; b <= 0xffff; ++b)
+	{
+		double db = half_to_double(static_cast< uint16_t >(b));
+		for (int operation = 0; operation < 4; ++operation)
+		{
+			uint16_t expected = hardware_half(da, db, operation);
+			uint16_t actual = emulated[operation](a, static_cast< uint16_t >(b), static_cast< sf_rounding >(mode));
+			if (actual != expected && !(is_nan(actual, 0) && is_nan(expected, 0)))
+				report.mismatch(0, mode, operation, a, b, actual, expected);
+		}
+	}
+	report.checked[0] += 4 * 0x10000;
+}
+
+static void check_single(Report &report, int mode, uint64_t seed, size_t count)
+{
+	static uint32_t (*const emulated[4])(uint32_t, uint32_t, sf_rounding) = { sf_f_add, sf_f_sub, sf_f_mul, sf_f_div };
+	std::mt19937_64 generator(seed);
+	for (size_t i = 0; i < count; ++i)
+	{
+		uint64_t operands = generator();
+		uint32_t a = static_cast< uint32_t >(operands), b = static_cast< uint32_t >(operands >> 32);
+		for (int operation = 0; operation < 4; ++operation)
+		{
+			uint32_t expected = hardware_single(a, b, operation);
+			uint32_t actual = emulated[operation](a, b, static_cast< sf_rounding >(mode));
+			if (actual != expected && !(is_nan(actual, 1) && is_nan(expected, 1)))
+				report.mismatch(1, mode, operation, a, b, actual, expected);
+		}
+	}
+	report.checked[1] += 4 * count;
+}
+
+static uint16_t double_to_half(double value)
+{
+	volatile _Float16 rounded = static_cast< _Float16 >(value);
+	_Float16 copy = rounded;
+	uint16_t bits;
+	std::memcpy(&bits, &copy, sizeof(bits));
+	return bits;
+}
+
+// Rounding the binary64 sum to odd keeps enough information for the second rounding to half to be correct.
+static uint16_t hardware_half_fma(double a, double b, double c, int mode)
+{
+	volatile double product = a * b, addend = c;
+	std::fesetround(FE_TOWARDZERO);
+	std::feclearexcept(FE_INEXACT);
+	volatile double sum = product + addend;
+	bool inexact = std::fetestexcept(FE_INEXACT);
+	std::fesetround(hardware_modes[mode]);
+	// Exact cancellations take the sign of zero from the target mode.
+	if (!inexact)
+	{
+		volatile double exact = product + addend;
+		return double_to_half(exact);
+	}
+	double odd = sum;
+	if (std::isfinite(odd))
+	{
+		uint64_t bits;
+		std::memcpy(&bits, &odd, sizeof(bits));
+		bits |= 1;
+		std::memcpy(&odd, &bits, sizeof(bits));
+	}
+	return double_to_half(odd);
+}
+
+static uint32_t hardware_single_fma(uint32_t a, uint32_t b, uint32_t c)
+{
+	float fa, fb, fc;
+	std::memcpy(&fa, &a, sizeof(fa));
+	std::memcpy(&fb, &b, sizeof(fb));
+	std::memcpy(&fc, &c, sizeof(fc));
+	volatile float x = fa, y = fb, z = fc;
+	float result = std::fma(static_cast< float >(x), static_cast< float >(y), static_cast< float >(z));
+	uint32_t bits;
+	std::memcpy(&bits, &result, sizeof(bits));
+	return bits;
+}
+
+static void check_fma(Report &report, int format, int mode, uint64_t seed, size_t count)
+{
+	std::mt19937_64 generator(seed);
+	sf_rounding round_num = static_cast< sf_rounding >(mode);
+	for (size_t i = 0; i < count; ++i)
+	{
+		uint64_t operands = generator(), extra = generator();
+		uint32_t a, b, c, expected, actual;
+		if (format == 0)
+		{
+			uint16_t ha = static_cast< uint16_t >(operands), hb = static_cast< uint16_t >(operands >> 16);
+			uint16_t hc = static_cast< uint16_t >(operands >> 32);
+			double da = half_to_double(ha), db = half_to_double(hb);
+			if ((extra & 3) == 0)
+				hc = static_cast< uint16_t >(double_to_half(-da * db) + (extra >> 2) % 5 - 2);
+			expected = hardware_half_fma(da, db, half_to_double(hc), mode);
+			actual = sf_h_fma(ha, hb, hc, round_num);
+			a = ha, b = hb, c = hc;
+		}
+		else
+		{
+			a = static_cast< uint32_t >(operands);
+			b = static_cast< uint32_t >(operands >> 32);
+			c = static_cast< uint32_t >(extra >> 32);
+			if ((extra & 3) == 0)
+			{
+				float fa, fb;
+				std::memcpy(&fa, &a, sizeof(fa));
+				std::memcpy(&fb, &b, sizeof(fb));
+				volatile float product = -fa * fb;
+				float rounded = product;
+				std::memcpy(&c, &rounded, sizeof(c));
+				c += static_cast< uint32_t >((extra >> 2) % 5) - 2;
+			}
+			expected = hardware_single_fma(a, b, c);
+			actual = sf_f_fma(a, b, c, round_num);
+		}
+		if (actual != expected && !(is_nan(actual, format) && is_nan(expected, format)))
+			report.mismatch(format, mode, 4, a, b, actual, expected, c);
+	}
+	report.checked[format] += count;
+}
+
+int main(int argc, char **argv)
+{
+	size_t threads = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 0;
+	if (threads == 0)
+		threads = std::max(1u, std::thread::hardware_concurrency());
+	size_t stride = argc > 2 ? std::max(1ull, std::strtoull(argv[2], nullptr, 10)) : 1;
+	size_t single_samples = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : size_t(1) << 24;
+	size_t fma_samples = argc > 4 ? std::strtoull(argv[4], nullptr, 10) : size_t(1) << 22;
+
+	// A task is one rounding mode with either one first half operand or one slice of random samples.
+	const size_t half_tasks = (0x10000 + stride - 1) / stride;
+	const size_t slice = size_t(1) << 16;
+	const size_t single_tasks = (single_samples + slice - 1) / slice;
+	const size_t fma_tasks = (fma_samples + slice - 1) / slice;
+	const size_t tasks_per_mode = half_tasks + single_tasks + 2 * fma_tasks;
+
+	Report report;
+	std::atomic< size_t > next_task{ 0 };
+	auto start = std::chrono::steady_clock::now();
+	std::vector< std::thread > workers;
+	for (size_t t = 0; t < threads; ++t)
+	{
+		workers.emplace_back(
+			[&]
+			{
+				int current_mode = -1;
+				for (size_t task; (task = next_task++) < 4 * tasks_per_mode;)
+				{
+					int mode = static_cast< int >(task / tasks_per_mode);
+					size_t index = task % tasks_per_mode;
+					if (mode != current_mode && std::fesetround(hardware_modes[mode]) == 0)
+						current_mode = mode;
+					if (index < half_tasks)
+					{
+						size_t first = index * stride + std::min(index % stride, 0xffff - index * stride);
+						check_half(report, mode, static_cast< uint16_t >(first));
+					}
+					else if (index < half_tasks + single_tasks)
+					{
+						size_t first = (index - half_tasks) * slice;
+						check_single(report, mode, task, std::min(slice, single_samples - first));
+					}
+					else
+					{
+						size_t fma_index = index - half_tasks - single_tasks;
+						size_t first = fma_index / 2 * slice;
+						int format = static_cast< int >(fma_index % 2);
+						check_fma(report, format, mode, task, std::min(slice, fma_samples - first));
+					}
+				}
+			});
+	}
+	for (std::thread &worker : workers)
+		worker.join();
+	double seconds = std::chrono::duration< double >(std::chrono::steady_clock::now() - start).count();
+
+	uint64_t total_mismatches = 0;
+	std::printf("\nformat mode  add         sub         mul         div         fma\n");
+	for (int format = 0; format < 2; ++format)
+	{
+		for (int mode = 0; mode < 4; ++mode)
+		{
+			std::printf("%-6s %d   ", format == 0 ? "half" : "single", mode);
+			for (int operation = 0; operation < 5; ++operation)
+			{
+				uint64_t count = report.mismatches[format][mode][operation];
+				total_mismatches += count;
+				std::printf(" %-11llu", static_cast< unsigned long long >(count));
+			}
+			std::printf("\n");
+		}
+	}
+	uint64_t checked = report.checked[0] + report.checked[1];
+	std::printf("\n%llu half and %llu single operations on %zu threads in %.1f s (%.1f Mops/s), %llu mismatches\n",
+				static_cast< unsigned long long >(report.checked[0]),
+				static_cast< unsigned long long >(report.checked[1]),
+				threads,
+				seconds,
+				static_cast< double >(checked) / seconds / 1e6,
+				static_cast< unsigned long long >(total_mismatches));
+	return total_mismatches == 0 ? 0 : 1;
+}
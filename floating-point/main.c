@@ -1,152 +1,156 @@
+#define _POSIX_C_SOURCE 200809L
+
 #include "return_codes.h"
+#include "softfloat.h"
 
 #include <inttypes.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
-#define UINT32_LENGTH 32
-#define UINT64_LENGTH 64
-
-typedef enum
-{
-	Number,
-	Zero,
-	Infinity,
-	NaN
-} spec_type;
-
-typedef struct
-{
-	int16_t exp_min;
-	int16_t exp_max;
-	int16_t exp_min_denorm;
-	uint8_t size;
-	uint8_t mnt_len;
-	uint8_t exp_len;
-} Constants;
-
-typedef struct
-{
-	uint32_t mnt;
-	int16_t exp;
-	uint8_t sign;
-	spec_type ft_spec_t;
-} FloatType;
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define HAVE_MMAP 1
+#define HAVE_SYSCONF 1
+#endif
 
-void init_consts_f(Constants *consts)
-{
-	consts->size = 32;
-	consts->mnt_len = 23;
-	consts->exp_len = 8;
-	consts->exp_min = -127;
-	consts->exp_max = 128;
-	consts->exp_min_denorm = -149;
-}
-
-void init_consts_h(Constants *consts)
-{
-	consts->size = 16;
-	consts->mnt_len = 10;
-	consts->exp_len = 5;
-	consts->exp_min = -15;
-	consts->exp_max = 16;
-	consts->exp_min_denorm = -24;
-}
+#ifdef _WIN32
+#define seek_file _fseeki64
+#define tell_file _ftelli64
+#else
+#define seek_file fseek
+#define tell_file ftell
+#endif
 
-uint32_t cut_bits_32(uint32_t bits, uint8_t start, uint8_t end)
-{
-	return ((bits & (((uint64_t)1 << (UINT32_LENGTH - start + 1)) - 1)) >> (UINT32_LENGTH - end));
-}
-uint64_t make_ones(uint8_t length)
-{
-	return (((uint64_t)1 << length) - 1);
-}
-uint8_t get_bit(uint64_t num, uint8_t place)
-{
-	return (num >> (place - 1)) & 1;
-}
-uint64_t get_n_bits(uint64_t num, uint8_t length)
-{
-	return num & make_ones(length);
-}
+#define UINT32_LENGTH 32
+#define BATCH_BUFFER_SIZE (1 << 16)
+#define FLOAT_TEXT_LENGTH 32
+#define BINARY_MAGIC "SFLT"
+#define BINARY_HEADER_SIZE 8
+// Dot mode header: "SDOT", accumulator ('h'/'f'), rounding, order ('s'/'p'/'b'), flags, uint32 row length and
+// uint32 block length. Half rows A[rows][length] follow, then B[rows][length] or a single B[length] vector.
+#define DOT_MAGIC "SDOT"
+#define DOT_HEADER_SIZE 16
+#define DOT_FUSED 1
+#define DOT_SHARED_VECTOR 2
 
-uint8_t bit_length(uint64_t number)
+size_t format_float(char *out, const sf_float *ft, const sf_format *consts)
 {
-	uint8_t length = 0;
-	while (number > 0)
+	static const char hex_digits[] = "0123456789abcdef";
+	size_t length = 0;
+	if (ft->sign == 1 && ft->ft_spec_t != SF_NAN)
+		out[length++] = '-';
+	switch (ft->ft_spec_t)
 	{
-		length++;
-		number >>= 1;
+	case SF_NUMBER:
+	{
+		uint8_t offset = (4 - (consts->mnt_len % 4));
+		uint8_t char_count = (consts->mnt_len + offset) / 4;
+		uint32_t mnt_print = ft->mnt << offset;
+		memcpy(out + length, "0x1.", 4);
+		length += 4;
+		for (int i = char_count - 1; i >= 0; i--)
+			out[length++] = hex_digits[(mnt_print >> (4 * i)) & 0xf];
+		out[length++] = 'p';
+		int exp = ft->exp;
+		if (exp < 0)
+		{
+			out[length++] = '-';
+			exp = -exp;
+		}
+		else
+			out[length++] = '+';
+		char digits[8];
+		int digit_count = 0;
+		do
+		{
+			digits[digit_count++] = (char)('0' + exp % 10);
+			exp /= 10;
+		} while (exp > 0);
+		while (digit_count > 0)
+			out[length++] = digits[--digit_count];
+		out[length++] = '\n';
+		break;
+	}
+	case SF_ZERO:
+		memcpy(out + length, "0x0.", 4);
+		length += 4;
+		memset(out + length, '0', consts->exp_len - 2);
+		length += consts->exp_len - 2;
+		memcpy(out + length, "p+0\n", 4);
+		length += 4;
+		break;
+	case SF_INFINITY:
+		memcpy(out + length, "inf", 3);
+		length += 3;
+		break;
+	case SF_NAN:
+		memcpy(out + length, "nan", 3);
+		length += 3;
+		break;
 	}
 	return length;
 }
-
-uint64_t add_bit(uint64_t num, uint8_t place)
-{
-	return num + ((uint64_t)1 << (place - 1));
-}
-uint64_t subtract_bit(uint64_t num, uint8_t place)
+void print_float(const sf_float *ft, const sf_format *consts)
 {
-	return num - ((uint64_t)1 << (place - 1));
+	char text[FLOAT_TEXT_LENGTH];
+	fwrite(text, 1, format_float(text, ft, consts), stdout);
 }
 
-void init_float(FloatType *ft, uint32_t num, const Constants *consts)
+int parse_hex(const char **cursor, uint32_t *value)
 {
-	int prefix = UINT32_LENGTH - consts->size;
-	ft->sign = num >> (consts->size - 1);
-	uint32_t exponent_bits = cut_bits_32(num, prefix + 2, prefix + 1 + consts->exp_len);
-	ft->exp = exponent_bits + consts->exp_min;
-	ft->mnt = cut_bits_32(num, prefix + 2 + consts->exp_len, UINT32_LENGTH);
-	ft->ft_spec_t = Number;
-	if (ft->mnt == 0)
-	{
-		if (ft->exp == consts->exp_min)
-			ft->ft_spec_t = Zero;
-		else if (ft->exp == consts->exp_max)
-			ft->ft_spec_t = Infinity;
-	}
-	else if (ft->exp == consts->exp_max)
-		ft->ft_spec_t = NaN;
+	const char *position = *cursor;
+	if (position[0] == '0' && (position[1] == 'x' || position[1] == 'X'))
+		position += 2;
+	const char *digits_start = position;
+	uint32_t result = 0;
+	for (;; position++)
+	{
+		uint32_t digit;
+		if (*position >= '0' && *position <= '9')
+			digit = *position - '0';
+		else if (*position >= 'a' && *position <= 'f')
+			digit = *position - 'a' + 10;
+		else if (*position >= 'A' && *position <= 'F')
+			digit = *position - 'A' + 10;
+		else
+			break;
+		if (result >> (UINT32_LENGTH - 4))
+			return ERROR_DATA_INVALID;
+		result = (result << 4) | digit;
+	}
+	if (position == digits_start)
+		return ERROR_DATA_INVALID;
+	*value = result;
+	*cursor = position;
+	return SUCCESS;
 }
 
-void normalize(FloatType *ft, const Constants *consts)
+int parse_rounding(const char **cursor, uint8_t *rounding)
 {
-	if (ft->ft_spec_t != Number || ft->exp != consts->exp_min)
-		return;
-	ft->exp++;
-	uint8_t zero_num = consts->mnt_len - bit_length(ft->mnt);
-	uint8_t offset = zero_num + 1;
-	ft->exp -= offset;
-	ft->mnt = (ft->mnt << offset) - ((uint32_t)1 << consts->mnt_len);
-}
-void print_float(const FloatType *ft, const Constants *consts)
-{
-	uint8_t offset = (4 - (consts->mnt_len % 4));
-	uint8_t char_count = (consts->mnt_len + offset) / 4;
-	uint32_t mnt_print = ft->mnt << offset;
-	char *sign = (ft->sign == 1) ? "-" : "";
-	char *exp_sign = (ft->exp < 0) ? "" : "+";
-	switch (ft->ft_spec_t)
-	{
-	case Number:
-		printf("%s0x1.%0*" PRIx32 "p%s%" PRId16 "\n", sign, char_count, mnt_print, exp_sign, ft->exp);
-		break;
-	case Zero:
-		printf("%s0x0.%0*xp+0\n", sign, consts->exp_len - 2, 0);
-		break;
-	case Infinity:
-		printf("%sinf", sign);
-		break;
-	case NaN:
-		printf("nan");
-		break;
-	}
+	const char *position = *cursor;
+	if (*position < '0' || *position > '3')
+		return ERROR_DATA_INVALID;
+	*rounding = *position - '0';
+	*cursor = position + 1;
+	return SUCCESS;
 }
 
-int read_args(int argc, char **argv, char *fmt, uint8_t *rounding, uint32_t *num1, char *op_sign, uint32_t *num2)
+int read_args(int argc,
+			  char **argv,
+			  char *fmt,
+			  uint8_t *rounding,
+			  uint32_t *num1,
+			  char *op_sign,
+			  uint32_t *num2,
+			  char *addend_sign,
+			  uint32_t *num3)
 {
-	int read_flag;
-	if (argc != 4 && argc != 6)
+	if (argc != 4 && argc != 6 && argc != 8)
 	{
 		fprintf(stderr, "Wrong number of arguments\n");
 		return ERROR_ARGUMENTS_INVALID;
@@ -157,19 +161,19 @@ int read_args(int argc, char **argv, char *fmt, uint8_t *rounding, uint32_t *num
 		return ERROR_ARGUMENTS_INVALID;
 	}
 	*fmt = argv[1][0];
-	read_flag = sscanf(argv[2], "%" SCNu8, rounding);
-	if (read_flag != 1 || *rounding > 3)
+	const char *cursor = argv[2];
+	if (parse_rounding(&cursor, rounding) != SUCCESS || *cursor != '\0')
 	{
 		fprintf(stderr, "Rounding type must be in {0,1,2,3}\n");
 		return ERROR_ARGUMENTS_INVALID;
 	}
-	read_flag = sscanf(argv[3], "%" SCNx32, num1);
-	if (read_flag != 1)
+	cursor = argv[3];
+	if (parse_hex(&cursor, num1) != SUCCESS || *cursor != '\0')
 	{
 		fprintf(stderr, "First number is incorrect\n");
 		return ERROR_ARGUMENTS_INVALID;
 	}
-	if (argc == 6)
+	if (argc >= 6)
 	{
 		if (argv[4][1] != '\0')
 		{
@@ -177,292 +181,627 @@ int read_args(int argc, char **argv, char *fmt, uint8_t *rounding, uint32_t *num
 			return ERROR_ARGUMENTS_INVALID;
 		}
 		*op_sign = argv[4][0];
-		read_flag = sscanf(argv[5], "%" SCNx32, num2);
-		if (read_flag != 1)
+		cursor = argv[5];
+		if (parse_hex(&cursor, num2) != SUCCESS || *cursor != '\0')
 		{
 			fprintf(stderr, "Second number is incorrect\n");
 			return ERROR_ARGUMENTS_INVALID;
 		}
 	}
+	if (argc == 8)
+	{
+		if (argv[6][1] != '\0')
+		{
+			fprintf(stderr, "Operation sign must be character\n");
+			return ERROR_ARGUMENTS_INVALID;
+		}
+		*addend_sign = argv[6][0];
+		cursor = argv[7];
+		if (parse_hex(&cursor, num3) != SUCCESS || *cursor != '\0')
+		{
+			fprintf(stderr, "Third number is incorrect\n");
+			return ERROR_ARGUMENTS_INVALID;
+		}
+	}
 	return SUCCESS;
 }
 
-void rounding(FloatType *result, uint64_t offset, uint8_t offset_len, uint8_t zero_num, uint8_t round_num, const Constants *consts)
+typedef sf_float (*operation_fn)(const sf_float *, const sf_float *, sf_rounding, const sf_format *);
+
+operation_fn find_operation(char op_sign)
 {
-	if (result->exp < consts->exp_min - consts->mnt_len + 1)
+	switch (op_sign)
 	{
-		result->ft_spec_t = Zero;
+	case '+':
+		return sf_add;
+	case '-':
+		return sf_sub;
+	case '*':
+		return sf_mul;
+	case '/':
+		return sf_div;
+	default:
+		return NULL;
 	}
-	if (result->exp >= consts->exp_max)
+}
+
+int evaluate_operation(const sf_float *ft1,
+					   char op_sign,
+					   const sf_float *ft2,
+					   uint8_t rounding,
+					   sf_float *result,
+					   const sf_format *consts)
+{
+	operation_fn operation = find_operation(op_sign);
+	if (operation == NULL)
 	{
-		result->ft_spec_t = Infinity;
+		fprintf(stderr, "Unknown operation\n");
+		return ERROR_ARGUMENTS_INVALID;
 	}
-	if (result->ft_spec_t != Infinity && result->ft_spec_t != Zero && offset == 0)
-		return;
-	switch (round_num)
+	*result = operation(ft1, ft2, rounding, consts);
+	return SUCCESS;
+}
+
+// "a * b + c" and "a * b - c" are evaluated as one fused multiply-add.
+int evaluate_fused(const sf_float *ft1,
+				   char op_sign,
+				   const sf_float *ft2,
+				   char addend_sign,
+				   const sf_float *ft3,
+				   uint8_t rounding,
+				   sf_float *result,
+				   const sf_format *consts)
+{
+	if (op_sign != '*' || (addend_sign != '+' && addend_sign != '-'))
 	{
-	case 0:
-		break;
-	case 1:
-		if (get_bit(offset, offset_len) == 0)
-			return;
-		if (get_n_bits(offset, offset_len - 1) > 0)
-			result->mnt = add_bit(result->mnt, zero_num + 1);
-		if (get_n_bits(offset, offset_len - 1) == 0)
-			result->mnt += get_bit(result->mnt, zero_num + 1);
-		break;
-	case 2:
-		if (result->sign == 0)
-			result->mnt = add_bit(result->mnt, zero_num + 1);
-		break;
-	case 3:
-		if (result->sign == 1)
-			result->mnt = add_bit(result->mnt, zero_num + 1);
-		break;
+		fprintf(stderr, "Unknown operation\n");
+		return ERROR_ARGUMENTS_INVALID;
 	}
-	if (get_bit(result->mnt, consts->mnt_len + 1))
+	sf_float addend = *ft3;
+	if (addend_sign == '-')
+		addend.sign = 1 - addend.sign;
+	*result = sf_fma(ft1, ft2, &addend, rounding, consts);
+	return SUCCESS;
+}
+typedef struct
+{
+	FILE *stream;
+	size_t start;
+	size_t end;
+	int eof;
+	char data[BATCH_BUFFER_SIZE];
+} LineReader;
+
+typedef struct
+{
+	FILE *stream;
+	size_t length;
+	int failed;
+	char data[BATCH_BUFFER_SIZE];
+} BufferedWriter;
+
+int read_line(LineReader *reader, char **line, size_t *length)
+{
+	for (;;)
 	{
-		result->exp++;
-		result->mnt = 0;
+		char *begin = reader->data + reader->start;
+		char *newline = memchr(begin, '\n', reader->end - reader->start);
+		if (newline || (reader->eof && reader->end > reader->start))
+		{
+			*line = begin;
+			*length = newline ? (size_t)(newline - begin) : reader->end - reader->start;
+			reader->start += *length + (newline != NULL);
+			if (*length > 0 && begin[*length - 1] == '\r')
+				(*length)--;
+			begin[*length] = '\0';
+			return 1;
+		}
+		if (reader->eof)
+			return 0;
+		if (reader->start == 0 && reader->end == BATCH_BUFFER_SIZE - 1)
+			return -1;
+		memmove(reader->data, begin, reader->end - reader->start);
+		reader->end -= reader->start;
+		reader->start = 0;
+		size_t read_count = fread(reader->data + reader->end, 1, BATCH_BUFFER_SIZE - 1 - reader->end, reader->stream);
+		reader->end += read_count;
+		if (read_count == 0)
+			reader->eof = 1;
 	}
 }
-void add(FloatType *ft1, FloatType *ft2, uint8_t round_num, FloatType *result, const Constants *consts)
+
+void write_bytes(BufferedWriter *writer, const char *bytes, size_t length)
 {
-	int spec_flag = 1;
-	if (ft1->ft_spec_t == NaN || ft2->ft_spec_t == NaN ||
-		(ft1->ft_spec_t == Infinity && ft2->ft_spec_t == Infinity && ft1->sign != ft2->sign))
-		result->ft_spec_t = NaN;
-	else if (ft1->ft_spec_t == Infinity)
-		*result = *ft1;
-	else if (ft2->ft_spec_t == Infinity)
-		*result = *ft2;
-	else if (ft1->ft_spec_t == Zero && ft2->ft_spec_t == Zero && ft2->sign == 1)
-		*result = *ft1;
-	else if (ft1->ft_spec_t == Zero && ft2->ft_spec_t == Zero)
-		*result = *ft2;
-	else if (ft1->ft_spec_t == Zero)
-		*result = *ft2;
-	else if (ft2->ft_spec_t == Zero)
-		*result = *ft1;
+	if (writer->length + length > BATCH_BUFFER_SIZE)
+	{
+		if (fwrite(writer->data, 1, writer->length, writer->stream) != writer->length)
+			writer->failed = 1;
+		writer->length = 0;
+	}
+	memcpy(writer->data + writer->length, bytes, length);
+	writer->length += length;
+}
+
+int flush_writer(BufferedWriter *writer)
+{
+	if (fwrite(writer->data, 1, writer->length, writer->stream) != writer->length || fflush(writer->stream) != 0)
+		writer->failed = 1;
+	writer->length = 0;
+	return writer->failed ? ERROR_UNKNOWN : SUCCESS;
+}
+
+int evaluate_line(const char *line, sf_float *result, const sf_format **consts)
+{
+	const char *cursor = line;
+	while (*cursor == ' ' || *cursor == '\t')
+		cursor++;
+	if (*cursor == 'h')
+		*consts = &sf_half_consts;
+	else if (*cursor == 'f')
+		*consts = &sf_single_consts;
 	else
+		return ERROR_DATA_INVALID;
+	cursor++;
+
+	uint8_t round_num;
+	uint32_t num1, num2, num3;
+	char op_sign = '\0', addend_sign = '\0';
+	if ((*cursor != ' ' && *cursor != '\t'))
+		return ERROR_DATA_INVALID;
+	while (*cursor == ' ' || *cursor == '\t')
+		cursor++;
+	if (parse_rounding(&cursor, &round_num) != SUCCESS || (*cursor != ' ' && *cursor != '\t'))
+		return ERROR_DATA_INVALID;
+	while (*cursor == ' ' || *cursor == '\t')
+		cursor++;
+	if (parse_hex(&cursor, &num1) != SUCCESS)
+		return ERROR_DATA_INVALID;
+	while (*cursor == ' ' || *cursor == '\t')
+		cursor++;
+	if (*cursor != '\0')
 	{
-		result->ft_spec_t = Number;
-		spec_flag = 0;
+		op_sign = *cursor++;
+		if (*cursor != ' ' && *cursor != '\t')
+			return ERROR_DATA_INVALID;
+		while (*cursor == ' ' || *cursor == '\t')
+			cursor++;
+		if (parse_hex(&cursor, &num2) != SUCCESS)
+			return ERROR_DATA_INVALID;
+		while (*cursor == ' ' || *cursor == '\t')
+			cursor++;
+	}
+	if (op_sign != '\0' && *cursor != '\0')
+	{
+		addend_sign = *cursor++;
+		if (*cursor != ' ' && *cursor != '\t')
+			return ERROR_DATA_INVALID;
+		while (*cursor == ' ' || *cursor == '\t')
+			cursor++;
+		if (parse_hex(&cursor, &num3) != SUCCESS)
+			return ERROR_DATA_INVALID;
+		while (*cursor == ' ' || *cursor == '\t')
+			cursor++;
+		if (*cursor != '\0')
+			return ERROR_DATA_INVALID;
 	}
-	if (spec_flag)
-		return;
 
-	if ((ft2->exp > ft1->exp) || (ft2->exp == ft1->exp && ft2->mnt > ft1->mnt) ||
-		(ft2->exp == ft1->exp && ft2->mnt == ft1->mnt && ft1->sign == 1))
+	sf_float ft1 = sf_unpack(num1, *consts);
+	if (op_sign == '\0')
 	{
-		FloatType ft_temp = *ft1;
-		*ft1 = *ft2;
-		*ft2 = ft_temp;
+		*result = ft1;
+		return SUCCESS;
 	}
+	sf_float ft2 = sf_unpack(num2, *consts);
+	if (addend_sign != '\0')
+	{
+		sf_float ft3 = sf_unpack(num3, *consts);
+		if (evaluate_fused(&ft1, op_sign, &ft2, addend_sign, &ft3, round_num, result, *consts) != SUCCESS)
+			return ERROR_DATA_INVALID;
+		return SUCCESS;
+	}
+	if (evaluate_operation(&ft1, op_sign, &ft2, round_num, result, *consts) != SUCCESS)
+		return ERROR_DATA_INVALID;
+	return SUCCESS;
+}
 
-	result->exp = ft1->exp;
-	result->sign = ft1->sign;
-	uint8_t unit_place = consts->mnt_len + 1;
-	uint64_t mnt_1 = add_bit(ft1->mnt, unit_place);
-	uint64_t mnt_2 = add_bit(ft2->mnt, unit_place);
-	uint16_t exp_dif = ft1->exp - ft2->exp;
-	uint64_t mnt_add;
-	uint64_t offset = 0;
-	uint8_t offset_len = 0;
-	uint8_t zero_num = 0;
+int run_batch(int argc, char **argv)
+{
+	if (argc > 3)
+	{
+		fprintf(stderr, "Batch mode takes at most one input file\n");
+		return ERROR_ARGUMENTS_INVALID;
+	}
+	static LineReader reader;
+	static BufferedWriter writer;
+	reader.stream = stdin;
+	if (argc == 3 && (reader.stream = fopen(argv[2], "rb")) == NULL)
+	{
+		fprintf(stderr, "Cannot open input file\n");
+		return ERROR_CANNOT_OPEN_FILE;
+	}
+	writer.stream = stdout;
 
-	if (exp_dif > unit_place + 2)
+	int return_value = SUCCESS;
+	size_t line_number = 0;
+	char *line;
+	size_t length;
+	int read_status;
+	while ((read_status = read_line(&reader, &line, &length)) == 1)
 	{
-		mnt_add = mnt_1;
-		offset_len = 4;
-		offset = 1;
-		if (ft1->sign != ft2->sign)
+		line_number++;
+		if (length == 0)
+			continue;
+		sf_float result;
+		const sf_format *consts;
+		if (evaluate_line(line, &result, &consts) != SUCCESS)
 		{
-			mnt_add <<= offset_len;
-			mnt_add -= 1;
-			uint8_t lost_bit = (bit_length(mnt_add) != unit_place + offset_len);
-			result->exp -= lost_bit;
-			offset_len -= lost_bit;
-			offset = get_n_bits(mnt_add, offset_len);
-			mnt_add >>= offset_len;
+			fprintf(stderr, "Line %zu is incorrect\n", line_number);
+			return_value = ERROR_DATA_INVALID;
+			break;
 		}
-		result->mnt = subtract_bit(mnt_add, unit_place);
-		rounding(result, offset, offset_len, 0, round_num, consts);
-		return;
+		char text[FLOAT_TEXT_LENGTH];
+		size_t text_length = format_float(text, &result, consts);
+		if (text[text_length - 1] != '\n')
+			text[text_length++] = '\n';
+		write_bytes(&writer, text, text_length);
 	}
+	if (read_status < 0)
+	{
+		fprintf(stderr, "Line %zu is too long\n", line_number + 1);
+		return_value = ERROR_DATA_INVALID;
+	}
+	if (return_value == SUCCESS && ferror(reader.stream))
+		return_value = ERROR_UNKNOWN;
+	if (flush_writer(&writer) != SUCCESS && return_value == SUCCESS)
+		return_value = ERROR_UNKNOWN;
+	if (reader.stream != stdin)
+		fclose(reader.stream);
+	return return_value;
+}
 
-	mnt_1 <<= exp_dif;
-	if (ft1->sign == ft2->sign)
+typedef struct
+{
+	uint8_t *data;
+	size_t size;
+	int mapped;
+} InputFile;
+
+int open_input(const char *path, InputFile *file)
+{
+	file->data = NULL;
+	file->size = 0;
+	file->mapped = 0;
+#ifdef HAVE_MMAP
+	int descriptor = open(path, O_RDONLY);
+	if (descriptor < 0)
+		return ERROR_CANNOT_OPEN_FILE;
+	struct stat status;
+	if (fstat(descriptor, &status) != 0)
 	{
-		mnt_add = mnt_1 + mnt_2;
-		uint8_t overflow_bit = get_bit(mnt_add, unit_place + exp_dif + 1);
-		offset_len = exp_dif;
-		if (overflow_bit)
-		{
-			offset_len++;
-			result->exp++;
-		}
+		close(descriptor);
+		return ERROR_CANNOT_OPEN_FILE;
 	}
-	else
+	file->size = (size_t)status.st_size;
+	if (file->size > 0)
 	{
-		mnt_add = mnt_1 - mnt_2;
-		if (mnt_add == 0)
+		void *data = mmap(NULL, file->size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+		if (data != MAP_FAILED)
 		{
-			result->ft_spec_t = Zero;
-			return;
+			posix_madvise(data, file->size, POSIX_MADV_SEQUENTIAL);
+			file->data = data;
+			file->mapped = 1;
 		}
-		uint8_t mnt_add_len = bit_length(mnt_add);
-		uint8_t mnt_dif = (unit_place + exp_dif) - mnt_add_len;
-		result->exp -= mnt_dif;
-		if (mnt_add_len > unit_place)
-			offset_len = mnt_add_len - unit_place;
-		else
-			mnt_add <<= (unit_place - mnt_add_len);
 	}
-
-	if (result->exp <= consts->exp_min)
-		zero_num = consts->exp_min - result->exp + 1;
-	offset_len += zero_num;
-	offset = get_n_bits(mnt_add, offset_len);
-	mnt_add >>= offset_len;
-	mnt_add <<= zero_num;
-	result->mnt = subtract_bit(mnt_add, unit_place);
-	rounding(result, offset, offset_len, zero_num, round_num, consts);
+	close(descriptor);
+	if (file->mapped || file->size == 0)
+		return SUCCESS;
+#endif
+	FILE *stream = fopen(path, "rb");
+	if (stream == NULL)
+		return ERROR_CANNOT_OPEN_FILE;
+	seek_file(stream, 0, SEEK_END);
+	long long size = tell_file(stream);
+	seek_file(stream, 0, SEEK_SET);
+	if (size < 0)
+	{
+		fclose(stream);
+		return ERROR_CANNOT_OPEN_FILE;
+	}
+	file->size = (size_t)size;
+	file->data = malloc(file->size ? file->size : 1);
+	if (file->data == NULL)
+	{
+		fclose(stream);
+		return ERROR_NOTENOUGH_MEMORY;
+	}
+	int return_value = fread(file->data, 1, file->size, stream) == file->size ? SUCCESS : ERROR_CANNOT_OPEN_FILE;
+	fclose(stream);
+	return return_value;
 }
-void divide(FloatType *ft1, FloatType *ft2, uint8_t round_num, FloatType *result, const Constants *consts)
-{
-	result->sign = ft1->sign ^ ft2->sign;
-	if (ft1->ft_spec_t == NaN || ft2->ft_spec_t == NaN || (ft1->ft_spec_t == Zero && ft2->ft_spec_t == Zero) ||
-		(ft1->ft_spec_t == Infinity && ft2->ft_spec_t == Infinity))
-		result->ft_spec_t = NaN;
-	else if (ft1->ft_spec_t == Infinity || ft2->ft_spec_t == Zero)
-		result->ft_spec_t = Infinity;
-	else if (ft1->ft_spec_t == Zero || ft2->ft_spec_t == Infinity)
-		result->ft_spec_t = Zero;
-	else
-		result->ft_spec_t = Number;
-	if (result->ft_spec_t != Number)
-		return;
 
-	result->exp = ft1->exp - ft2->exp;
-	uint8_t unit_place = consts->mnt_len + 1;
-	uint8_t division_offset = UINT64_LENGTH - unit_place;
-	uint64_t mnt_1 = add_bit(ft1->mnt, unit_place);
-	uint64_t mnt_2 = add_bit(ft2->mnt, unit_place);
-	mnt_1 <<= division_offset;
-	uint64_t mnt_div = mnt_1 / mnt_2;
-	uint64_t mnt_div_len = bit_length(mnt_div);
-	if (mnt_div_len == division_offset)
-		result->exp--;
-	uint8_t zero_num = 0;
-	if (result->exp <= consts->exp_min)
-		zero_num = consts->exp_min - result->exp + 1;
-	uint8_t offset_len = mnt_div_len - unit_place + zero_num;
-	uint64_t offset = get_n_bits(mnt_div, offset_len);
-	mnt_div >>= offset_len;
-	mnt_div <<= zero_num;
-	result->mnt = subtract_bit(mnt_div, unit_place);
-	if ((mnt_1 % mnt_2) != 0)
-	{
-		offset = (offset << 1) + 1;
-		offset_len++;
-	}
-	rounding(result, offset, offset_len, zero_num, round_num, consts);
-}
-void multiply(FloatType *ft1, FloatType *ft2, uint8_t round_num, FloatType *result, const Constants *consts)
+void close_input(InputFile *file)
 {
-	result->sign = ft1->sign ^ ft2->sign;
-	if (ft1->ft_spec_t == NaN || ft2->ft_spec_t == NaN || (ft1->ft_spec_t == Infinity && ft2->ft_spec_t == Zero) ||
-		(ft1->ft_spec_t == Zero && ft2->ft_spec_t == Infinity))
-		result->ft_spec_t = NaN;
-	else if (ft1->ft_spec_t == Infinity || ft2->ft_spec_t == Infinity)
-		result->ft_spec_t = Infinity;
-	else if (ft1->ft_spec_t == Zero || ft2->ft_spec_t == Zero)
-		result->ft_spec_t = Zero;
-	else
-		result->ft_spec_t = Number;
-	if (result->ft_spec_t != Number)
+#ifdef HAVE_MMAP
+	if (file->mapped)
+	{
+		munmap(file->data, file->size);
 		return;
-
-	result->exp = ft1->exp + ft2->exp;
-	uint8_t unit_place = consts->mnt_len + 1;
-	uint64_t mnt_with_bit = add_bit(ft1->mnt, unit_place) * add_bit(ft2->mnt, unit_place);
-	uint8_t offset_len = consts->mnt_len;
-	if (bit_length(mnt_with_bit) == unit_place * 2)
-	{
-		offset_len += 1;
-		result->exp += 1;
-	}
-	uint8_t zero_num = 0;
-	if (result->exp <= consts->exp_min)
-		zero_num = consts->exp_min - result->exp + 1;
-	offset_len += zero_num;
-	uint64_t offset = get_n_bits(mnt_with_bit, offset_len);
-	mnt_with_bit >>= offset_len;
-	mnt_with_bit <<= zero_num;
-	result->mnt = subtract_bit(mnt_with_bit, unit_place);
-	rounding(result, offset, offset_len, zero_num, round_num, consts);
+	}
+#endif
+	free(file->data);
 }
-int evaluate_operation(FloatType *ft1, char op_sign, FloatType *ft2, uint8_t rounding, FloatType *result, const Constants *consts)
+
+typedef void (*array_fn)(const uint16_t *, const uint16_t *, uint16_t *, size_t, sf_rounding);
+
+array_fn find_half_array(char op_sign)
 {
 	switch (op_sign)
 	{
 	case '+':
-		add(ft1, ft2, rounding, result, consts);
-		break;
+		return sf_h_add_array;
 	case '-':
-		ft2->sign = 1 - ft2->sign;
-		add(ft1, ft2, rounding, result, consts);
-		break;
+		return sf_h_sub_array;
 	case '*':
-		multiply(ft1, ft2, rounding, result, consts);
-		break;
-	case '/':
-		divide(ft1, ft2, rounding, result, consts);
-		break;
+		return sf_h_mul_array;
 	default:
-		fprintf(stderr, "Unknown operation\n");
+		return NULL;
+	}
+}
+
+uint32_t load_operand(const uint8_t *array, size_t index, uint8_t width)
+{
+	if (width == 2)
+		return ((const uint16_t *)array)[index];
+	return ((const uint32_t *)array)[index];
+}
+
+int evaluate_binary(const uint8_t *header, const uint8_t *payload, size_t count, FILE *output)
+{
+	const sf_format *consts = header[4] == 'h' ? &sf_half_consts : &sf_single_consts;
+	sf_rounding round_num = (sf_rounding)header[5];
+	operation_fn operation = find_operation((char)header[6]);
+	if (header[5] > 3 || operation == NULL)
+		return ERROR_FORMAT_INVALID;
+
+	uint8_t width = consts->size / 8;
+	const uint8_t *first = payload;
+	const uint8_t *second = payload + count * width;
+	static uint8_t buffer[BATCH_BUFFER_SIZE];
+	size_t chunk = BATCH_BUFFER_SIZE / width;
+	array_fn half_array = width == 2 ? find_half_array((char)header[6]) : NULL;
+	for (size_t start = 0; start < count; start += chunk)
+	{
+		size_t end = count - start < chunk ? count : start + chunk;
+		if (half_array != NULL)
+		{
+			const uint16_t *a = (const uint16_t *)first + start, *b = (const uint16_t *)second + start;
+			half_array(a, b, (uint16_t *)buffer, end - start, round_num);
+		}
+		else
+		{
+			for (size_t i = start; i < end; i++)
+			{
+				sf_float ft1 = sf_unpack(load_operand(first, i, width), consts);
+				sf_float ft2 = sf_unpack(load_operand(second, i, width), consts);
+				sf_float result = operation(&ft1, &ft2, round_num, consts);
+				uint32_t bits = sf_pack(&result, consts);
+				if (width == 2)
+					((uint16_t *)buffer)[i - start] = (uint16_t)bits;
+				else
+					((uint32_t *)buffer)[i - start] = bits;
+			}
+		}
+		if (fwrite(buffer, width, end - start, output) != end - start)
+			return ERROR_UNKNOWN;
+	}
+	return SUCCESS;
+}
+
+int run_binary(int argc, char **argv)
+{
+	if (argc != 4)
+	{
+		fprintf(stderr, "Binary mode takes an input and an output file\n");
 		return ERROR_ARGUMENTS_INVALID;
 	}
+	InputFile input;
+	int return_value = open_input(argv[2], &input);
+	if (return_value != SUCCESS)
+	{
+		fprintf(stderr, "Cannot read input file\n");
+		return return_value;
+	}
+	const uint8_t *header = input.data;
+	if (input.size < BINARY_HEADER_SIZE || memcmp(header, BINARY_MAGIC, 4) != 0 ||
+		(header[4] != 'h' && header[4] != 'f'))
+	{
+		fprintf(stderr, "Input file is not a packed operand file\n");
+		close_input(&input);
+		return ERROR_FORMAT_INVALID;
+	}
+	size_t pair_size = header[4] == 'h' ? 2 * sizeof(uint16_t) : 2 * sizeof(uint32_t);
+	if ((input.size - BINARY_HEADER_SIZE) % pair_size != 0)
+	{
+		fprintf(stderr, "Operand arrays have different lengths\n");
+		close_input(&input);
+		return ERROR_FORMAT_INVALID;
+	}
+	FILE *output = fopen(argv[3], "wb");
+	if (output == NULL)
+	{
+		fprintf(stderr, "Cannot open output file\n");
+		close_input(&input);
+		return ERROR_CANNOT_OPEN_FILE;
+	}
+	size_t count = (input.size - BINARY_HEADER_SIZE) / pair_size;
+	return_value = evaluate_binary(header, input.data + BINARY_HEADER_SIZE, count, output);
+	if (fclose(output) != 0 && return_value == SUCCESS)
+		return_value = ERROR_UNKNOWN;
+	if (return_value == ERROR_FORMAT_INVALID)
+		fprintf(stderr, "Header holds an unknown rounding or operation\n");
+	else if (return_value != SUCCESS)
+		fprintf(stderr, "Cannot write output file\n");
+	close_input(&input);
+	return return_value;
+}
+
+unsigned online_processors(void)
+{
+#ifdef HAVE_SYSCONF
+	long count = sysconf(_SC_NPROCESSORS_ONLN);
+	if (count > 0)
+		return (unsigned)count;
+#endif
+	return 1;
+}
+
+int evaluate_dot(const uint16_t *a,
+				 const uint16_t *b,
+				 size_t b_stride,
+				 size_t rows,
+				 size_t length,
+				 const sf_dot_options *options,
+				 FILE *output)
+{
+	static uint32_t results[BATCH_BUFFER_SIZE / sizeof(uint32_t)];
+	static uint16_t narrowed[BATCH_BUFFER_SIZE / sizeof(uint32_t)];
+	size_t chunk = BATCH_BUFFER_SIZE / sizeof(uint32_t);
+	unsigned threads = online_processors();
+	for (size_t start = 0; start < rows; start += chunk)
+	{
+		size_t count = rows - start < chunk ? rows - start : chunk;
+		sf_h_dot_rows(a + start * length, b + start * b_stride, b_stride, count, length, results, options, threads);
+		size_t written;
+		if (options->accumulator == &sf_half_consts)
+		{
+			for (size_t i = 0; i < count; i++)
+				narrowed[i] = (uint16_t)results[i];
+			written = fwrite(narrowed, sizeof(uint16_t), count, output);
+		}
+		else
+			written = fwrite(results, sizeof(uint32_t), count, output);
+		if (written != count)
+			return ERROR_UNKNOWN;
+	}
 	return SUCCESS;
 }
+
+int run_dot(int argc, char **argv)
+{
+	if (argc != 4)
+	{
+		fprintf(stderr, "Dot mode takes an input and an output file\n");
+		return ERROR_ARGUMENTS_INVALID;
+	}
+	InputFile input;
+	int return_value = open_input(argv[2], &input);
+	if (return_value != SUCCESS)
+	{
+		fprintf(stderr, "Cannot read input file\n");
+		return return_value;
+	}
+	const uint8_t *header = input.data;
+	uint32_t length = 0, block = 0;
+	if (input.size >= DOT_HEADER_SIZE)
+	{
+		memcpy(&length, header + 8, sizeof(length));
+		memcpy(&block, header + 12, sizeof(block));
+	}
+	if (input.size < DOT_HEADER_SIZE || memcmp(header, DOT_MAGIC, 4) != 0 || (header[4] != 'h' && header[4] != 'f') ||
+		length == 0)
+	{
+		fprintf(stderr, "Input file is not a dot product file\n");
+		close_input(&input);
+		return ERROR_FORMAT_INVALID;
+	}
+	if (header[5] > 3 || (header[6] != 's' && header[6] != 'p' && header[6] != 'b') ||
+		(header[7] & ~(DOT_FUSED | DOT_SHARED_VECTOR)) != 0)
+	{
+		fprintf(stderr, "Header holds an unknown rounding, order or flag\n");
+		close_input(&input);
+		return ERROR_FORMAT_INVALID;
+	}
+	int shared = (header[7] & DOT_SHARED_VECTOR) != 0;
+	size_t payload = input.size - DOT_HEADER_SIZE, row_size = (size_t)length * sizeof(uint16_t);
+	if (payload % row_size != 0 || (shared ? payload == 0 : payload % (2 * row_size) != 0))
+	{
+		fprintf(stderr, "Operand arrays do not match the row length\n");
+		close_input(&input);
+		return ERROR_FORMAT_INVALID;
+	}
+	FILE *output = fopen(argv[3], "wb");
+	if (output == NULL)
+	{
+		fprintf(stderr, "Cannot open output file\n");
+		close_input(&input);
+		return ERROR_CANNOT_OPEN_FILE;
+	}
+
+	sf_dot_options options;
+	options.accumulator = header[4] == 'h' ? &sf_half_consts : &sf_single_consts;
+	options.round_num = (sf_rounding)header[5];
+	options.order = header[6] == 'p' ? SF_ORDER_PAIRWISE : header[6] == 'b' ? SF_ORDER_BLOCKED : SF_ORDER_SEQUENTIAL;
+	options.block = block;
+	options.fused = (header[7] & DOT_FUSED) != 0;
+	size_t rows = shared ? payload / row_size - 1 : payload / (2 * row_size);
+	const uint16_t *a = (const uint16_t *)(input.data + DOT_HEADER_SIZE);
+	return_value = evaluate_dot(a, a + rows * length, shared ? 0 : length, rows, length, &options, output);
+	if (fclose(output) != 0 && return_value == SUCCESS)
+		return_value = ERROR_UNKNOWN;
+	if (return_value != SUCCESS)
+		fprintf(stderr, "Cannot write output file\n");
+	close_input(&input);
+	return return_value;
+}
+
 int main(int argc, char *argv[])
 {
-	char fmt, op_sign;
+	if (argc >= 2 && strcmp(argv[1], "batch") == 0)
+		return run_batch(argc, argv);
+	if (argc >= 2 && strcmp(argv[1], "binary") == 0)
+		return run_binary(argc, argv);
+	if (argc >= 2 && strcmp(argv[1], "dot") == 0)
+		return run_dot(argc, argv);
+
+	char fmt, op_sign, addend_sign;
 	uint8_t round_num;
-	uint32_t num1, num2;
+	uint32_t num1, num2, num3;
 	int return_value = 0;
-	if ((return_value = read_args(argc, argv, &fmt, &round_num, &num1, &op_sign, &num2)) != 0)
+	if ((return_value = read_args(argc, argv, &fmt, &round_num, &num1, &op_sign, &num2, &addend_sign, &num3)) != 0)
 		return return_value;
 
-	Constants consts;
+	const sf_format *consts;
 	switch (fmt)
 	{
 	case 'h':
-		init_consts_h(&consts);
+		consts = &sf_half_consts;
 		break;
 	case 'f':
-		init_consts_f(&consts);
+		consts = &sf_single_consts;
 		break;
 	default:
 		fprintf(stderr, "Format must be 'h'/'f'\n");
 		return ERROR_ARGUMENTS_INVALID;
 	}
-	FloatType ft1;
-	init_float(&ft1, num1, &consts);
-	normalize(&ft1, &consts);
+	sf_float ft1 = sf_unpack(num1, consts);
 
-	if (argc == 6)
+	if (argc == 8)
+	{
+		sf_float ft2 = sf_unpack(num2, consts), ft3 = sf_unpack(num3, consts), result;
+		return_value = evaluate_fused(&ft1, op_sign, &ft2, addend_sign, &ft3, round_num, &result, consts);
+		if (return_value != 0)
+			return return_value;
+		print_float(&result, consts);
+	}
+	else if (argc == 6)
 	{
-		FloatType ft2, result;
-		init_float(&ft2, num2, &consts);
-		normalize(&ft2, &consts);
-		return_value = evaluate_operation(&ft1, op_sign, &ft2, round_num, &result, &consts);
+		sf_float ft2 = sf_unpack(num2, consts), result;
+		return_value = evaluate_operation(&ft1, op_sign, &ft2, round_num, &result, consts);
 		if (return_value != 0)
 			return return_value;
-		print_float(&result, &consts);
+		print_float(&result, consts);
 	}
 	else
-		print_float(&ft1, &consts);
+		print_float(&ft1, consts);
 	return SUCCESS;
 }
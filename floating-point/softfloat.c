@@ -0,0 +1,544 @@
+#include "softfloat.h"
+
+#define UINT32_LENGTH 32
+#define UINT64_LENGTH 64
+#define FMA_FRAME_LENGTH 60
+
+const sf_format sf_half_consts = {
+	.exp_min = -15, .exp_max = 16, .exp_min_denorm = -24, .size = 16, .mnt_len = 10, .exp_len = 5
+};
+const sf_format sf_single_consts = {
+	.exp_min = -127, .exp_max = 128, .exp_min_denorm = -149, .size = 32, .mnt_len = 23, .exp_len = 8
+};
+
+static uint32_t cut_bits_32(uint32_t bits, uint8_t start, uint8_t end)
+{
+	return ((bits & (((uint64_t)1 << (UINT32_LENGTH - start + 1)) - 1)) >> (UINT32_LENGTH - end));
+}
+static uint64_t make_ones(uint8_t length)
+{
+	return (((uint64_t)1 << length) - 1);
+}
+static uint8_t get_bit(uint64_t num, uint8_t place)
+{
+	return (num >> (place - 1)) & 1;
+}
+static uint64_t get_n_bits(uint64_t num, uint8_t length)
+{
+	return num & make_ones(length);
+}
+
+static uint8_t bit_length(uint64_t number)
+{
+	uint8_t length = 0;
+	while (number > 0)
+	{
+		length++;
+		number >>= 1;
+	}
+	return length;
+}
+
+static uint64_t add_bit(uint64_t num, uint8_t place)
+{
+	return num + ((uint64_t)1 << (place - 1));
+}
+static uint64_t subtract_bit(uint64_t num, uint8_t place)
+{
+	return num - ((uint64_t)1 << (place - 1));
+}
+
+static void init_float(sf_float *ft, uint32_t num, const sf_format *consts)
+{
+	int prefix = UINT32_LENGTH - consts->size;
+	ft->sign = num >> (consts->size - 1);
+	uint32_t exponent_bits = cut_bits_32(num, prefix + 2, prefix + 1 + consts->exp_len);
+	ft->exp = exponent_bits + consts->exp_min;
+	ft->mnt = cut_bits_32(num, prefix + 2 + consts->exp_len, UINT32_LENGTH);
+	ft->ft_spec_t = SF_NUMBER;
+	if (ft->mnt == 0)
+	{
+		if (ft->exp == consts->exp_min)
+			ft->ft_spec_t = SF_ZERO;
+		else if (ft->exp == consts->exp_max)
+			ft->ft_spec_t = SF_INFINITY;
+	}
+	else if (ft->exp == consts->exp_max)
+		ft->ft_spec_t = SF_NAN;
+}
+
+static void normalize(sf_float *ft, const sf_format *consts)
+{
+	if (ft->ft_spec_t != SF_NUMBER || ft->exp != consts->exp_min)
+		return;
+	ft->exp++;
+	uint8_t zero_num = consts->mnt_len - bit_length(ft->mnt);
+	uint8_t offset = zero_num + 1;
+	ft->exp -= offset;
+	ft->mnt = (ft->mnt << offset) - ((uint32_t)1 << consts->mnt_len);
+}
+
+sf_float sf_unpack(uint32_t bits, const sf_format *consts)
+{
+	sf_float ft;
+	init_float(&ft, bits, consts);
+	normalize(&ft, consts);
+	return ft;
+}
+uint32_t sf_pack(const sf_float *ft, const sf_format *consts)
+{
+	uint32_t exp_ones = (uint32_t)make_ones(consts->exp_len);
+	uint32_t bits;
+	switch (ft->ft_spec_t)
+	{
+	case SF_NUMBER:
+		if (ft->exp > consts->exp_min)
+			bits = (uint32_t)(ft->exp - consts->exp_min) << consts->mnt_len | ft->mnt;
+		else
+			bits = (ft->mnt | (uint32_t)1 << consts->mnt_len) >> (consts->exp_min + 1 - ft->exp);
+		break;
+	case SF_ZERO:
+		bits = 0;
+		break;
+	case SF_INFINITY:
+		bits = exp_ones << consts->mnt_len;
+		break;
+	default:
+		return (exp_ones << consts->mnt_len) | (uint32_t)1 << (consts->mnt_len - 1);
+	}
+	return bits | (uint32_t)ft->sign << (consts->size - 1);
+}
+
+static uint8_t subnormal_shift(int16_t exp, const sf_format *consts)
+{
+	if (exp > consts->exp_min)
+		return 0;
+	// Anything shifted past the unit bit only contributes to the sticky bit.
+	if (exp < consts->exp_min - consts->mnt_len)
+		return consts->mnt_len + 2;
+	return consts->exp_min - exp + 1;
+}
+
+static void rounding(sf_float *result,
+					 uint64_t offset,
+					 uint8_t offset_len,
+					 uint8_t zero_num,
+					 uint8_t round_num,
+					 const sf_format *consts)
+{
+	uint8_t round_bit = offset_len > 0 && get_bit(offset, offset_len);
+	uint8_t sticky_bit = offset_len > 1 && get_n_bits(offset, offset_len - 1) > 0;
+	int underflow = result->exp < consts->exp_min - consts->mnt_len + 1;
+	uint8_t last_bit = !underflow && get_bit(add_bit(result->mnt, consts->mnt_len + 1), zero_num + 1);
+	int increment = 0;
+	switch (round_num)
+	{
+	case 0:
+		break;
+	case 1:
+		increment = round_bit && (sticky_bit || last_bit);
+		break;
+	case 2:
+		increment = (round_bit || sticky_bit) && result->sign == 0;
+		break;
+	case 3:
+		increment = (round_bit || sticky_bit) && result->sign == 1;
+		break;
+	}
+	if (underflow)
+	{
+		if (increment)
+		{
+			result->exp = consts->exp_min - consts->mnt_len + 1;
+			result->mnt = 0;
+		}
+		else
+			result->ft_spec_t = SF_ZERO;
+		return;
+	}
+	if (increment)
+	{
+		result->mnt = add_bit(result->mnt, zero_num + 1);
+		if (get_bit(result->mnt, consts->mnt_len + 1))
+		{
+			result->exp++;
+			result->mnt = 0;
+		}
+	}
+	if (result->exp >= consts->exp_max)
+	{
+		if (round_num == 1 || (round_num == 2 && result->sign == 0) || (round_num == 3 && result->sign == 1))
+			result->ft_spec_t = SF_INFINITY;
+		else
+		{
+			result->exp = consts->exp_max - 1;
+			result->mnt = make_ones(consts->mnt_len);
+		}
+	}
+}
+static void add(const sf_float *operand1,
+				const sf_float *operand2,
+				uint8_t round_num,
+				sf_float *result,
+				const sf_format *consts)
+{
+	sf_float copy1 = *operand1, copy2 = *operand2;
+	sf_float *ft1 = &copy1, *ft2 = &copy2;
+	int spec_flag = 1;
+	if (ft1->ft_spec_t == SF_NAN || ft2->ft_spec_t == SF_NAN ||
+		(ft1->ft_spec_t == SF_INFINITY && ft2->ft_spec_t == SF_INFINITY && ft1->sign != ft2->sign))
+		result->ft_spec_t = SF_NAN;
+	else if (ft1->ft_spec_t == SF_INFINITY)
+		*result = *ft1;
+	else if (ft2->ft_spec_t == SF_INFINITY)
+		*result = *ft2;
+	else if (ft1->ft_spec_t == SF_ZERO && ft2->ft_spec_t == SF_ZERO)
+	{
+		*result = *ft1;
+		if (ft1->sign != ft2->sign)
+			result->sign = round_num == 3;
+	}
+	else if (ft1->ft_spec_t == SF_ZERO)
+		*result = *ft2;
+	else if (ft2->ft_spec_t == SF_ZERO)
+		*result = *ft1;
+	else
+	{
+		result->ft_spec_t = SF_NUMBER;
+		spec_flag = 0;
+	}
+	if (spec_flag)
+		return;
+
+	if ((ft2->exp > ft1->exp) || (ft2->exp == ft1->exp && ft2->mnt > ft1->mnt) ||
+		(ft2->exp == ft1->exp && ft2->mnt == ft1->mnt && ft1->sign == 1))
+	{
+		sf_float ft_temp = *ft1;
+		*ft1 = *ft2;
+		*ft2 = ft_temp;
+	}
+
+	result->exp = ft1->exp;
+	result->sign = ft1->sign;
+	uint8_t unit_place = consts->mnt_len + 1;
+	uint64_t mnt_1 = add_bit(ft1->mnt, unit_place);
+	uint64_t mnt_2 = add_bit(ft2->mnt, unit_place);
+	uint16_t exp_dif = ft1->exp - ft2->exp;
+	uint64_t mnt_add;
+	uint64_t offset = 0;
+	uint8_t offset_len = 0;
+	uint8_t zero_num = 0;
+
+	if (exp_dif > unit_place + 2)
+	{
+		mnt_add = mnt_1;
+		offset_len = 4;
+		offset = 1;
+		if (ft1->sign != ft2->sign)
+		{
+			mnt_add <<= offset_len;
+			mnt_add -= 1;
+			uint8_t lost_bit = (bit_length(mnt_add) != unit_place + offset_len);
+			result->exp -= lost_bit;
+			offset_len -= lost_bit;
+			offset = get_n_bits(mnt_add, offset_len);
+			mnt_add >>= offset_len;
+		}
+		result->mnt = subtract_bit(mnt_add, unit_place);
+		rounding(result, offset, offset_len, 0, round_num, consts);
+		return;
+	}
+
+	mnt_1 <<= exp_dif;
+	if (ft1->sign == ft2->sign)
+	{
+		mnt_add = mnt_1 + mnt_2;
+		uint8_t overflow_bit = get_bit(mnt_add, unit_place + exp_dif + 1);
+		offset_len = exp_dif;
+		if (overflow_bit)
+		{
+			offset_len++;
+			result->exp++;
+		}
+	}
+	else
+	{
+		mnt_add = mnt_1 - mnt_2;
+		if (mnt_add == 0)
+		{
+			result->ft_spec_t = SF_ZERO;
+			result->sign = round_num == 3;
+			return;
+		}
+		uint8_t mnt_add_len = bit_length(mnt_add);
+		uint8_t mnt_dif = (unit_place + exp_dif) - mnt_add_len;
+		result->exp -= mnt_dif;
+		if (mnt_add_len > unit_place)
+			offset_len = mnt_add_len - unit_place;
+		else
+			mnt_add <<= (unit_place - mnt_add_len);
+	}
+
+	zero_num = subnormal_shift(result->exp, consts);
+	offset_len += zero_num;
+	offset = get_n_bits(mnt_add, offset_len);
+	mnt_add >>= offset_len;
+	mnt_add <<= zero_num;
+	result->mnt = subtract_bit(mnt_add, unit_place);
+	rounding(result, offset, offset_len, zero_num, round_num, consts);
+}
+static void divide(const sf_float *operand1,
+				   const sf_float *operand2,
+				   uint8_t round_num,
+				   sf_float *result,
+				   const sf_format *consts)
+{
+	sf_float copy1 = *operand1, copy2 = *operand2;
+	sf_float *ft1 = &copy1, *ft2 = &copy2;
+	result->sign = ft1->sign ^ ft2->sign;
+	if (ft1->ft_spec_t == SF_NAN || ft2->ft_spec_t == SF_NAN ||
+		(ft1->ft_spec_t == SF_ZERO && ft2->ft_spec_t == SF_ZERO) ||
+		(ft1->ft_spec_t == SF_INFINITY && ft2->ft_spec_t == SF_INFINITY))
+		result->ft_spec_t = SF_NAN;
+	else if (ft1->ft_spec_t == SF_INFINITY || ft2->ft_spec_t == SF_ZERO)
+		result->ft_spec_t = SF_INFINITY;
+	else if (ft1->ft_spec_t == SF_ZERO || ft2->ft_spec_t == SF_INFINITY)
+		result->ft_spec_t = SF_ZERO;
+	else
+		result->ft_spec_t = SF_NUMBER;
+	if (result->ft_spec_t != SF_NUMBER)
+		return;
+
+	result->exp = ft1->exp - ft2->exp;
+	uint8_t unit_place = consts->mnt_len + 1;
+	uint8_t division_offset = UINT64_LENGTH - unit_place;
+	uint64_t mnt_1 = add_bit(ft1->mnt, unit_place);
+	uint64_t mnt_2 = add_bit(ft2->mnt, unit_place);
+	mnt_1 <<= division_offset;
+	uint64_t mnt_div = mnt_1 / mnt_2;
+	uint64_t mnt_div_len = bit_length(mnt_div);
+	if (mnt_div_len == division_offset)
+		result->exp--;
+	uint8_t zero_num = subnormal_shift(result->exp, consts);
+	uint8_t offset_len = mnt_div_len - unit_place + zero_num;
+	uint64_t offset = get_n_bits(mnt_div, offset_len);
+	mnt_div >>= offset_len;
+	mnt_div <<= zero_num;
+	result->mnt = subtract_bit(mnt_div, unit_place);
+	if ((mnt_1 % mnt_2) != 0)
+	{
+		offset = (offset << 1) + 1;
+		offset_len++;
+	}
+	rounding(result, offset, offset_len, zero_num, round_num, consts);
+}
+static void multiply(const sf_float *operand1,
+					 const sf_float *operand2,
+					 uint8_t round_num,
+					 sf_float *result,
+					 const sf_format *consts)
+{
+	sf_float copy1 = *operand1, copy2 = *operand2;
+	sf_float *ft1 = &copy1, *ft2 = &copy2;
+	result->sign = ft1->sign ^ ft2->sign;
+	if (ft1->ft_spec_t == SF_NAN || ft2->ft_spec_t == SF_NAN ||
+		(ft1->ft_spec_t == SF_INFINITY && ft2->ft_spec_t == SF_ZERO) ||
+		(ft1->ft_spec_t == SF_ZERO && ft2->ft_spec_t == SF_INFINITY))
+		result->ft_spec_t = SF_NAN;
+	else if (ft1->ft_spec_t == SF_INFINITY || ft2->ft_spec_t == SF_INFINITY)
+		result->ft_spec_t = SF_INFINITY;
+	else if (ft1->ft_spec_t == SF_ZERO || ft2->ft_spec_t == SF_ZERO)
+		result->ft_spec_t = SF_ZERO;
+	else
+		result->ft_spec_t = SF_NUMBER;
+	if (result->ft_spec_t != SF_NUMBER)
+		return;
+
+	result->exp = ft1->exp + ft2->exp;
+	uint8_t unit_place = consts->mnt_len + 1;
+	uint64_t mnt_with_bit = add_bit(ft1->mnt, unit_place) * add_bit(ft2->mnt, unit_place);
+	uint8_t offset_len = consts->mnt_len;
+	if (bit_length(mnt_with_bit) == unit_place * 2)
+	{
+		offset_len += 1;
+		result->exp += 1;
+	}
+	uint8_t zero_num = subnormal_shift(result->exp, consts);
+	offset_len += zero_num;
+	uint64_t offset = get_n_bits(mnt_with_bit, offset_len);
+	mnt_with_bit >>= offset_len;
+	mnt_with_bit <<= zero_num;
+	result->mnt = subtract_bit(mnt_with_bit, unit_place);
+	rounding(result, offset, offset_len, zero_num, round_num, consts);
+}
+
+static uint64_t align_fma_operand(uint64_t mnt, uint8_t mnt_len, int32_t *exp)
+{
+	uint8_t shift = FMA_FRAME_LENGTH - mnt_len;
+	*exp -= shift;
+	return mnt << shift;
+}
+static void fused_multiply_add(const sf_float *operand1,
+							   const sf_float *operand2,
+							   const sf_float *operand3,
+							   uint8_t round_num,
+							   sf_float *result,
+							   const sf_format *consts)
+{
+	const sf_float *ft1 = operand1, *ft2 = operand2, *ft3 = operand3;
+	uint8_t product_sign = ft1->sign ^ ft2->sign;
+	int product_infinite = ft1->ft_spec_t == SF_INFINITY || ft2->ft_spec_t == SF_INFINITY;
+	int product_zero = ft1->ft_spec_t == SF_ZERO || ft2->ft_spec_t == SF_ZERO;
+	if (ft1->ft_spec_t == SF_NAN || ft2->ft_spec_t == SF_NAN || ft3->ft_spec_t == SF_NAN ||
+		(product_infinite && product_zero) ||
+		(product_infinite && ft3->ft_spec_t == SF_INFINITY && product_sign != ft3->sign))
+	{
+		result->ft_spec_t = SF_NAN;
+		result->sign = 0;
+		return;
+	}
+	if (product_infinite)
+	{
+		result->ft_spec_t = SF_INFINITY;
+		result->sign = product_sign;
+		return;
+	}
+	if (ft3->ft_spec_t == SF_INFINITY)
+	{
+		*result = *ft3;
+		return;
+	}
+	// An exact zero product or a zero addend leaves a single rounding to add or multiply.
+	if (product_zero)
+	{
+		sf_float product = { .mnt = 0, .exp = consts->exp_min, .sign = product_sign, .ft_spec_t = SF_ZERO };
+		add(&product, ft3, round_num, result, consts);
+		return;
+	}
+	if (ft3->ft_spec_t == SF_ZERO)
+	{
+		multiply(ft1, ft2, round_num, result, consts);
+		return;
+	}
+
+	// Both terms are placed in a FMA_FRAME_LENGTH-bit frame: the full product fits with room for guard bits, and
+	// anything shifted out of the smaller term only contributes to the sticky bit.
+	uint8_t unit_place = consts->mnt_len + 1;
+	int32_t product_exp = ft1->exp + ft2->exp - 2 * consts->mnt_len;
+	uint64_t product = add_bit(ft1->mnt, unit_place) * add_bit(ft2->mnt, unit_place);
+	product = align_fma_operand(product, 2 * unit_place - !get_bit(product, 2 * unit_place), &product_exp);
+	int32_t addend_exp = ft3->exp - consts->mnt_len;
+	uint64_t addend = align_fma_operand(add_bit(ft3->mnt, unit_place), unit_place, &addend_exp);
+
+	uint64_t larger = product, smaller = addend;
+	int32_t exp = product_exp, exp_dif = product_exp - addend_exp;
+	result->sign = product_sign;
+	if (addend_exp > product_exp || (addend_exp == product_exp && addend > product))
+	{
+		larger = addend;
+		smaller = product;
+		exp = addend_exp;
+		exp_dif = -exp_dif;
+		result->sign = ft3->sign;
+	}
+	if (exp_dif >= FMA_FRAME_LENGTH)
+		smaller = 1;
+	else if (exp_dif > 0)
+		smaller = (smaller >> exp_dif) | (get_n_bits(smaller, exp_dif) != 0);
+
+	uint64_t mnt_sum = product_sign == ft3->sign ? larger + smaller : larger - smaller;
+	if (mnt_sum == 0)
+	{
+		result->ft_spec_t = SF_ZERO;
+		result->sign = round_num == 3;
+		return;
+	}
+	// The sum rarely drops more than a bit below the frame, so scanning down from the carry bit is short.
+	uint8_t mnt_sum_len = FMA_FRAME_LENGTH + 1;
+	while (!get_bit(mnt_sum, mnt_sum_len))
+		mnt_sum_len--;
+	if (mnt_sum_len < FMA_FRAME_LENGTH)
+	{
+		mnt_sum <<= FMA_FRAME_LENGTH - mnt_sum_len;
+		exp -= FMA_FRAME_LENGTH - mnt_sum_len;
+		mnt_sum_len = FMA_FRAME_LENGTH;
+	}
+
+	result->ft_spec_t = SF_NUMBER;
+	result->exp = (int16_t)(exp + mnt_sum_len - 1);
+	uint8_t zero_num = subnormal_shift(result->exp, consts);
+	uint8_t offset_len = mnt_sum_len - unit_place + zero_num;
+	uint64_t offset = get_n_bits(mnt_sum, offset_len);
+	mnt_sum >>= offset_len;
+	mnt_sum <<= zero_num;
+	result->mnt = subtract_bit(mnt_sum, unit_place);
+	rounding(result, offset, offset_len, zero_num, round_num, consts);
+}
+
+sf_float sf_add(const sf_float *ft1, const sf_float *ft2, sf_rounding round_num, const sf_format *consts)
+{
+	sf_float result;
+	add(ft1, ft2, round_num, &result, consts);
+	return result;
+}
+
+sf_float sf_sub(const sf_float *ft1, const sf_float *ft2, sf_rounding round_num, const sf_format *consts)
+{
+	sf_float negated = *ft2, result;
+	negated.sign = 1 - negated.sign;
+	add(ft1, &negated, round_num, &result, consts);
+	return result;
+}
+
+sf_float sf_mul(const sf_float *ft1, const sf_float *ft2, sf_rounding round_num, const sf_format *consts)
+{
+	sf_float result;
+	multiply(ft1, ft2, round_num, &result, consts);
+	return result;
+}
+
+sf_float sf_div(const sf_float *ft1, const sf_float *ft2, sf_rounding round_num, const sf_format *consts)
+{
+	sf_float result;
+	divide(ft1, ft2, round_num, &result, consts);
+	return result;
+}
+
+sf_float sf_fma(const sf_float *ft1,
+				 const sf_float *ft2,
+				 const sf_float *ft3,
+				 sf_rounding round_num,
+				 const sf_format *consts)
+{
+	sf_float result;
+	fused_multiply_add(ft1, ft2, ft3, round_num, &result, consts);
+	return result;
+}
+
+#define SF_BITS_OPERATION(name, type, consts, operation)                                                               \
+	type name(type a, type b, sf_rounding round_num)                                                                   \
+	{                                                                                                                  \
+		sf_float ft1 = sf_unpack(a, &(consts)), ft2 = sf_unpack(b, &(consts));                                       \
+		sf_float result = operation(&ft1, &ft2, round_num, &(consts));                                                \
+		return (type)sf_pack(&result, &(consts));                                                                      \
+	}
+
+SF_BITS_OPERATION(sf_h_add, uint16_t, sf_half_consts, sf_add)
+SF_BITS_OPERATION(sf_h_sub, uint16_t, sf_half_consts, sf_sub)
+SF_BITS_OPERATION(sf_h_mul, uint16_t, sf_half_consts, sf_mul)
+SF_BITS_OPERATION(sf_h_div, uint16_t, sf_half_consts, sf_div)
+SF_BITS_OPERATION(sf_f_add, uint32_t, sf_single_consts, sf_add)
+SF_BITS_OPERATION(sf_f_sub, uint32_t, sf_single_consts, sf_sub)
+SF_BITS_OPERATION(sf_f_mul, uint32_t, sf_single_consts, sf_mul)
+SF_BITS_OPERATION(sf_f_div, uint32_t, sf_single_consts, sf_div)
+
+#define SF_BITS_FMA(name, type, consts)                                                                                \
+	type name(type a, type b, type c, sf_rounding round_num)                                                           \
+	{                                                                                                                  \
+		sf_float ft1 = sf_unpack(a, &(consts)), ft2 = sf_unpack(b, &(consts)), ft3 = sf_unpack(c, &(consts));         \
+		sf_float result = sf_fma(&ft1, &ft2, &ft3, round_num, &(consts));                                             \
+		return (type)sf_pack(&result, &(consts));                                                                      \
+	}
+
+SF_BITS_FMA(sf_h_fma, uint16_t, sf_half_consts)
+SF_BITS_FMA(sf_f_fma, uint32_t, sf_single_consts)
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+// Soft-float emulation of IEEE 754 binary16 ('h') and binary32 ('f') arithmetic with selectable rounding.
+// Every function is pure and thread-safe. Build as a static library with
+//   cc -std=c17 -O2 -c softfloat.c softfloat_simd.c softfloat_dot.c &&
+//   ar rcs libsoftfloat.a softfloat.o softfloat_simd.o softfloat_dot.o
+
+typedef enum
+{
+	SF_ROUND_TOWARD_ZERO = 0,
+	SF_ROUND_NEAREST_EVEN = 1,
+	SF_ROUND_TOWARD_POSITIVE = 2,
+	SF_ROUND_TOWARD_NEGATIVE = 3
+} sf_rounding;
+
+typedef enum
+{
+	SF_NUMBER,
+	SF_ZERO,
+	SF_INFINITY,
+	SF_NAN
+} sf_spec_type;
+
+typedef struct
+{
+	int16_t exp_min;
+	int16_t exp_max;
+	int16_t exp_min_denorm;
+	uint8_t size;
+	uint8_t mnt_len;
+	uint8_t exp_len;
+} sf_format;
+
+typedef struct
+{
+	uint32_t mnt;
+	int16_t exp;
+	uint8_t sign;
+	sf_spec_type ft_spec_t;
+} sf_float;
+
+extern const sf_format sf_half_consts;
+extern const sf_format sf_single_consts;
+
+// Unpacked interface: operands stay decoded between operations.
+sf_float sf_unpack(uint32_t bits, const sf_format *consts);
+uint32_t sf_pack(const sf_float *ft, const sf_format *consts);
+sf_float sf_add(const sf_float *ft1, const sf_float *ft2, sf_rounding round_num, const sf_format *consts);
+sf_float sf_sub(const sf_float *ft1, const sf_float *ft2, sf_rounding round_num, const sf_format *consts);
+sf_float sf_mul(const sf_float *ft1, const sf_float *ft2, sf_rounding round_num, const sf_format *consts);
+sf_float sf_div(const sf_float *ft1, const sf_float *ft2, sf_rounding round_num, const sf_format *consts);
+// Fused multiply-add: ft1 * ft2 + ft3 with a single rounding.
+sf_float sf_fma(const sf_float *ft1,
+				 const sf_float *ft2,
+				 const sf_float *ft3,
+				 sf_rounding round_num,
+				 const sf_format *consts);
+
+// Bit-pattern interface.
+uint16_t sf_h_add(uint16_t a, uint16_t b, sf_rounding round_num);
+uint16_t sf_h_sub(uint16_t a, uint16_t b, sf_rounding round_num);
+uint16_t sf_h_mul(uint16_t a, uint16_t b, sf_rounding round_num);
+uint16_t sf_h_div(uint16_t a, uint16_t b, sf_rounding round_num);
+uint16_t sf_h_fma(uint16_t a, uint16_t b, uint16_t c, sf_rounding round_num);
+uint32_t sf_f_add(uint32_t a, uint32_t b, sf_rounding round_num);
+uint32_t sf_f_sub(uint32_t a, uint32_t b, sf_rounding round_num);
+uint32_t sf_f_mul(uint32_t a, uint32_t b, sf_rounding round_num);
+uint32_t sf_f_div(uint32_t a, uint32_t b, sf_rounding round_num);
+uint32_t sf_f_fma(uint32_t a, uint32_t b, uint32_t c, sf_rounding round_num);
+
+// Element-wise half arrays: out[i] = a[i] op b[i], bit-identical to sf_h_*. Branch-free SIMD with GCC and Clang
+// (softfloat_simd.c; build with -mavx2 or -mavx512f to widen the lanes), a scalar loop elsewhere.
+void sf_h_add_array(const uint16_t *a, const uint16_t *b, uint16_t *out, size_t count, sf_rounding round_num);
+void sf_h_sub_array(const uint16_t *a, const uint16_t *b, uint16_t *out, size_t count, sf_rounding round_num);
+void sf_h_mul_array(const uint16_t *a, const uint16_t *b, uint16_t *out, size_t count, sf_rounding round_num);
+
+// Dot products of half vectors with a chosen accumulator format, rounding mode and reduction order (softfloat_dot.c).
+// Sequential: sum = sum + a[i] * b[i] from +0. Pairwise: the range is split in halves (the first half gets length / 2
+// terms) and the two partial sums are added. Blocked: sequential sums over blocks of `block` terms (0 means one
+// block), themselves summed sequentially. Products are rounded to the accumulator format (exact for single) unless
+// `fused` makes each sequential step one sf_fma. Without b the elements of a are reduced directly.
+typedef enum
+{
+	SF_ORDER_SEQUENTIAL = 0,
+	SF_ORDER_PAIRWISE = 1,
+	SF_ORDER_BLOCKED = 2
+} sf_order;
+
+typedef struct
+{
+	const sf_format *accumulator;
+	sf_rounding round_num;
+	sf_order order;
+	size_t block;
+	int fused;
+} sf_dot_options;
+
+sf_float sf_h_dot(const uint16_t *a, const uint16_t *b, size_t length, const sf_dot_options *options);
+// out[row] = packed sf_h_dot(a + row * length, b + row * b_stride), rows spread over up to `threads` threads.
+void sf_h_dot_rows(const uint16_t *a,
+				   const uint16_t *b,
+				   size_t b_stride,
+				   size_t rows,
+				   size_t length,
+				   uint32_t *out,
+				   const sf_dot_options *options,
+				   unsigned threads);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,458 @@
+#pragma once
+
+#include <bit>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+// Compile-time specialised counterpart of softfloat.h: the format and the rounding mode are template arguments, so
+// the format constants fold into the code and the rounding switch disappears. Results are bit-identical to the C
+// library.
+namespace softfloat
+{
+	enum class Rounding : uint8_t
+	{
+		TowardZero = 0,
+		NearestEven = 1,
+		TowardPositive = 2,
+		TowardNegative = 3
+	};
+
+	template< unsigned ExpLen, unsigned MntLen >
+	struct Format
+	{
+		static constexpr uint8_t exp_len = ExpLen;
+		static constexpr uint8_t mnt_len = MntLen;
+		static constexpr uint8_t size = 1 + ExpLen + MntLen;
+		static constexpr int16_t exp_min = 1 - (1 << (ExpLen - 1));
+		static constexpr int16_t exp_max = 1 << (ExpLen - 1);
+		using Bits = std::conditional_t< size <= 16, uint16_t, uint32_t >;
+	};
+
+	using Half = Format< 5, 10 >;
+	using Single = Format< 8, 23 >;
+
+	enum class Kind : uint8_t
+	{
+		Number,
+		Zero,
+		Infinity,
+		NaN
+	};
+
+	struct Unpacked
+	{
+		uint32_t mnt;
+		int16_t exp;
+		uint8_t sign;
+		Kind kind;
+	};
+
+	namespace detail
+	{
+		constexpr uint8_t get_bit(uint64_t num, uint8_t place)
+		{
+			return (num >> (place - 1)) & 1;
+		}
+
+		constexpr uint64_t get_n_bits(uint64_t num, uint8_t length)
+		{
+			return num & ((uint64_t(1) << length) - 1);
+		}
+
+		constexpr uint8_t bit_length(uint64_t number)
+		{
+			return static_cast< uint8_t >(64 - std::countl_zero(number));
+		}
+
+		constexpr uint64_t add_bit(uint64_t num, uint8_t place)
+		{
+			return num + (uint64_t(1) << (place - 1));
+		}
+
+		constexpr uint64_t subtract_bit(uint64_t num, uint8_t place)
+		{
+			return num - (uint64_t(1) << (place - 1));
+		}
+
+		template< typename F, Rounding R >
+		constexpr void round(Unpacked &result, uint64_t offset, uint8_t offset_len, uint8_t zero_num)
+		{
+			bool round_bit = offset_len > 0 && get_bit(offset, offset_len);
+			bool sticky_bit = offset_len > 1 && get_n_bits(offset, offset_len - 1) > 0;
+			bool underflow = result.exp < F::exp_min - F::mnt_len + 1;
+			bool last_bit = !underflow && get_bit(result.mnt | (uint32_t(1) << F::mnt_len), zero_num + 1);
+			bool increment = false;
+			if constexpr (R == Rounding::NearestEven)
+				increment = round_bit && (sticky_bit || last_bit);
+			else if constexpr (R == Rounding::TowardPositive)
+				increment = (round_bit || sticky_bit) && result.sign == 0;
+			else if constexpr (R == Rounding::TowardNegative)
+				increment = (round_bit || sticky_bit) && result.sign == 1;
+			if (underflow)
+			{
+				if (increment)
+				{
+					result.exp = F::exp_min - F::mnt_len + 1;
+					result.mnt = 0;
+				}
+				else
+					result.kind = Kind::Zero;
+				return;
+			}
+			if (increment)
+			{
+				result.mnt = static_cast< uint32_t >(add_bit(result.mnt, zero_num + 1));
+				if (get_bit(result.mnt, F::mnt_len + 1))
+				{
+					result.exp++;
+					result.mnt = 0;
+				}
+			}
+			if (result.exp >= F::exp_max)
+			{
+				if (R == Rounding::NearestEven || (R == Rounding::TowardPositive && result.sign == 0) ||
+					(R == Rounding::TowardNegative && result.sign == 1))
+					result.kind = Kind::Infinity;
+				else
+				{
+					result.exp = F::exp_max - 1;
+					result.mnt = (uint32_t(1) << F::mnt_len) - 1;
+				}
+			}
+		}
+
+		template< typename F >
+		constexpr uint8_t subnormal_shift(int16_t exp)
+		{
+			if (exp > F::exp_min)
+				return 0;
+			if (exp < F::exp_min - F::mnt_len)
+				return F::mnt_len + 2;
+			return static_cast< uint8_t >(F::exp_min - exp + 1);
+		}
+	}	 // namespace detail
+
+	template< typename F >
+	constexpr Unpacked unpack(typename F::Bits bits)
+	{
+		Unpacked ft;
+		ft.sign = static_cast< uint8_t >(bits >> (F::size - 1));
+		ft.exp = static_cast< int16_t >(((bits >> F::mnt_len) & ((1u << F::exp_len) - 1)) + F::exp_min);
+		ft.mnt = bits & ((uint32_t(1) << F::mnt_len) - 1);
+		ft.kind = Kind::Number;
+		if (ft.mnt == 0)
+		{
+			if (ft.exp == F::exp_min)
+				ft.kind = Kind::Zero;
+			else if (ft.exp == F::exp_max)
+				ft.kind = Kind::Infinity;
+		}
+		else if (ft.exp == F::exp_max)
+			ft.kind = Kind::NaN;
+		else if (ft.exp == F::exp_min)
+		{
+			uint8_t offset = F::mnt_len + 1 - detail::bit_length(ft.mnt);
+			ft.exp = static_cast< int16_t >(ft.exp + 1 - offset);
+			ft.mnt = (ft.mnt << offset) - (uint32_t(1) << F::mnt_len);
+		}
+		return ft;
+	}
+
+	template< typename F >
+	constexpr typename F::Bits pack(const Unpacked &ft)
+	{
+		constexpr uint32_t exp_ones = (uint32_t(1) << F::exp_len) - 1;
+		uint32_t bits;
+		switch (ft.kind)
+		{
+		case Kind::Number:
+			if (ft.exp > F::exp_min)
+				bits = uint32_t(ft.exp - F::exp_min) << F::mnt_len | ft.mnt;
+			else
+				bits = (ft.mnt | uint32_t(1) << F::mnt_len) >> (F::exp_min + 1 - ft.exp);
+			break;
+		case Kind::Zero:
+			bits = 0;
+			break;
+		case Kind::Infinity:
+			bits = exp_ones << F::mnt_len;
+			break;
+		default:
+			return static_cast< typename F::Bits >(exp_ones << F::mnt_len | uint32_t(1) << (F::mnt_len - 1));
+		}
+		return static_cast< typename F::Bits >(bits | uint32_t(ft.sign) << (F::size - 1));
+	}
+
+	template< typename F, Rounding R >
+	constexpr Unpacked add(Unpacked ft1, Unpacked ft2)
+	{
+		using namespace detail;
+		if (ft1.kind == Kind::NaN || ft2.kind == Kind::NaN ||
+			(ft1.kind == Kind::Infinity && ft2.kind == Kind::Infinity && ft1.sign != ft2.sign))
+			return Unpacked{ 0, 0, 0, Kind::NaN };
+		if (ft1.kind == Kind::Infinity)
+			return ft1;
+		if (ft2.kind == Kind::Infinity)
+			return ft2;
+		if (ft1.kind == Kind::Zero && ft2.kind == Kind::Zero)
+		{
+			if (ft1.sign != ft2.sign)
+				ft1.sign = R == Rounding::TowardNegative;
+			return ft1;
+		}
+		if (ft1.kind == Kind::Zero)
+			return ft2;
+		if (ft2.kind == Kind::Zero)
+			return ft1;
+
+		if ((ft2.exp > ft1.exp) || (ft2.exp == ft1.exp && ft2.mnt > ft1.mnt) ||
+			(ft2.exp == ft1.exp && ft2.mnt == ft1.mnt && ft1.sign == 1))
+			std::swap(ft1, ft2);
+
+		Unpacked result{ 0, ft1.exp, ft1.sign, Kind::Number };
+		constexpr uint8_t unit_place = F::mnt_len + 1;
+		uint64_t mnt_1 = add_bit(ft1.mnt, unit_place);
+		uint64_t mnt_2 = add_bit(ft2.mnt, unit_place);
+		uint16_t exp_dif = static_cast< uint16_t >(ft1.exp - ft2.exp);
+		uint64_t mnt_add;
+		uint8_t offset_len = 0;
+
+		if (exp_dif > unit_place + 2)
+		{
+			mnt_add = mnt_1;
+			offset_len = 4;
+			uint64_t offset = 1;
+			if (ft1.sign != ft2.sign)
+			{
+				mnt_add <<= offset_len;
+				mnt_add -= 1;
+				uint8_t lost_bit = bit_length(mnt_add) != unit_place + offset_len;
+				result.exp -= lost_bit;
+				offset_len -= lost_bit;
+				offset = get_n_bits(mnt_add, offset_len);
+				mnt_add >>= offset_len;
+			}
+			result.mnt = static_cast< uint32_t >(subtract_bit(mnt_add, unit_place));
+			round< F, R >(result, offset, offset_len, 0);
+			return result;
+		}
+
+		mnt_1 <<= exp_dif;
+		if (ft1.sign == ft2.sign)
+		{
+			mnt_add = mnt_1 + mnt_2;
+			offset_len = static_cast< uint8_t >(exp_dif);
+			if (get_bit(mnt_add, static_cast< uint8_t >(unit_place + exp_dif + 1)))
+			{
+				offset_len++;
+				result.exp++;
+			}
+		}
+		else
+		{
+			mnt_add = mnt_1 - mnt_2;
+			if (mnt_add == 0)
+			{
+				result.kind = Kind::Zero;
+				result.sign = R == Rounding::TowardNegative;
+				return result;
+			}
+			uint8_t mnt_add_len = bit_length(mnt_add);
+			result.exp -= static_cast< uint8_t >(unit_place + exp_dif - mnt_add_len);
+			if (mnt_add_len > unit_place)
+				offset_len = mnt_add_len - unit_place;
+			else
+				mnt_add <<= (unit_place - mnt_add_len);
+		}
+
+		uint8_t zero_num = subnormal_shift< F >(result.exp);
+		offset_len += zero_num;
+		uint64_t offset = get_n_bits(mnt_add, offset_len);
+		mnt_add >>= offset_len;
+		mnt_add <<= zero_num;
+		result.mnt = static_cast< uint32_t >(subtract_bit(mnt_add, unit_place));
+		round< F, R >(result, offset, offset_len, zero_num);
+		return result;
+	}
+
+	template< typename F, Rounding R >
+	constexpr Unpacked sub(Unpacked ft1, Unpacked ft2)
+	{
+		ft2.sign = 1 - ft2.sign;
+		return add< F, R >(ft1, ft2);
+	}
+
+	template< typename F, Rounding R >
+	constexpr Unpacked mul(const Unpacked &ft1, const Unpacked &ft2)
+	{
+		using namespace detail;
+		Unpacked result{ 0, 0, static_cast< uint8_t >(ft1.sign ^ ft2.sign), Kind::Number };
+		if (ft1.kind == Kind::NaN || ft2.kind == Kind::NaN || (ft1.kind == Kind::Infinity && ft2.kind == Kind::Zero) ||
+			(ft1.kind == Kind::Zero && ft2.kind == Kind::Infinity))
+			result.kind = Kind::NaN;
+		else if (ft1.kind == Kind::Infinity || ft2.kind == Kind::Infinity)
+			result.kind = Kind::Infinity;
+		else if (ft1.kind == Kind::Zero || ft2.kind == Kind::Zero)
+			result.kind = Kind::Zero;
+		if (result.kind != Kind::Number)
+			return result;
+
+		result.exp = static_cast< int16_t >(ft1.exp + ft2.exp);
+		constexpr uint8_t unit_place = F::mnt_len + 1;
+		uint64_t mnt_with_bit = add_bit(ft1.mnt, unit_place) * add_bit(ft2.mnt, unit_place);
+		uint8_t offset_len = F::mnt_len;
+		if (bit_length(mnt_with_bit) == unit_place * 2)
+		{
+			offset_len += 1;
+			result.exp += 1;
+		}
+		uint8_t zero_num = subnormal_shift< F >(result.exp);
+		offset_len += zero_num;
+		uint64_t offset = get_n_bits(mnt_with_bit, offset_len);
+		mnt_with_bit >>= offset_len;
+		mnt_with_bit <<= zero_num;
+		result.mnt = static_cast< uint32_t >(subtract_bit(mnt_with_bit, unit_place));
+		round< F, R >(result, offset, offset_len, zero_num);
+		return result;
+	}
+
+	template< typename F, Rounding R >
+	constexpr Unpacked div(const Unpacked &ft1, const Unpacked &ft2)
+	{
+		using namespace detail;
+		Unpacked result{ 0, 0, static_cast< uint8_t >(ft1.sign ^ ft2.sign), Kind::Number };
+		if (ft1.kind == Kind::NaN || ft2.kind == Kind::NaN || (ft1.kind == Kind::Zero && ft2.kind == Kind::Zero) ||
+			(ft1.kind == Kind::Infinity && ft2.kind == Kind::Infinity))
+			result.kind = Kind::NaN;
+		else if (ft1.kind == Kind::Infinity || ft2.kind == Kind::Zero)
+			result.kind = Kind::Infinity;
+		else if (ft1.kind == Kind::Zero || ft2.kind == Kind::Infinity)
+			result.kind = Kind::Zero;
+		if (result.kind != Kind::Number)
+			return result;
+
+		result.exp = static_cast< int16_t >(ft1.exp - ft2.exp);
+		constexpr uint8_t unit_place = F::mnt_len + 1;
+		constexpr uint8_t division_offset = 64 - unit_place;
+		uint64_t mnt_1 = add_bit(ft1.mnt, unit_place) << division_offset;
+		uint64_t mnt_2 = add_bit(ft2.mnt, unit_place);
+		uint64_t mnt_div = mnt_1 / mnt_2;
+		uint8_t mnt_div_len = bit_length(mnt_div);
+		if (mnt_div_len == division_offset)
+			result.exp--;
+		uint8_t zero_num = subnormal_shift< F >(result.exp);
+		uint8_t offset_len = mnt_div_len - unit_place + zero_num;
+		uint64_t offset = get_n_bits(mnt_div, offset_len);
+		mnt_div >>= offset_len;
+		mnt_div <<= zero_num;
+		result.mnt = static_cast< uint32_t >(subtract_bit(mnt_div, unit_place));
+		if (mnt_1 % mnt_2 != 0)
+		{
+			offset = (offset << 1) + 1;
+			offset_len++;
+		}
+		round< F, R >(result, offset, offset_len, zero_num);
+		return result;
+	}
+
+	template< typename F, Rounding R >
+	constexpr Unpacked fma(const Unpacked &ft1, const Unpacked &ft2, const Unpacked &ft3)
+	{
+		using namespace detail;
+		constexpr uint8_t frame_length = 60;
+		uint8_t product_sign = ft1.sign ^ ft2.sign;
+		bool product_infinite = ft1.kind == Kind::Infinity || ft2.kind == Kind::Infinity;
+		bool product_zero = ft1.kind == Kind::Zero || ft2.kind == Kind::Zero;
+		bool nan_operand = ft1.kind == Kind::NaN || ft2.kind == Kind::NaN || ft3.kind == Kind::NaN;
+		if (nan_operand || (product_infinite && product_zero) ||
+			(product_infinite && ft3.kind == Kind::Infinity && product_sign != ft3.sign))
+			return Unpacked{ 0, 0, 0, Kind::NaN };
+		if (product_infinite)
+			return Unpacked{ 0, 0, product_sign, Kind::Infinity };
+		if (ft3.kind == Kind::Infinity)
+			return ft3;
+		if (product_zero)
+			return add< F, R >(Unpacked{ 0, F::exp_min, product_sign, Kind::Zero }, ft3);
+		if (ft3.kind == Kind::Zero)
+			return mul< F, R >(ft1, ft2);
+
+		constexpr uint8_t unit_place = F::mnt_len + 1;
+		auto align = [](uint64_t mnt, int32_t &exp)
+		{
+			uint8_t shift = frame_length - bit_length(mnt);
+			exp -= shift;
+			return mnt << shift;
+		};
+		int32_t product_exp = ft1.exp + ft2.exp - 2 * F::mnt_len;
+		uint64_t product = align(add_bit(ft1.mnt, unit_place) * add_bit(ft2.mnt, unit_place), product_exp);
+		int32_t addend_exp = ft3.exp - F::mnt_len;
+		uint64_t addend = align(add_bit(ft3.mnt, unit_place), addend_exp);
+
+		Unpacked result{ 0, 0, product_sign, Kind::Number };
+		uint64_t larger = product, smaller = addend;
+		int32_t exp = product_exp, exp_dif = product_exp - addend_exp;
+		if (addend_exp > product_exp || (addend_exp == product_exp && addend > product))
+		{
+			std::swap(larger, smaller);
+			exp = addend_exp;
+			exp_dif = -exp_dif;
+			result.sign = ft3.sign;
+		}
+		if (exp_dif >= frame_length)
+			smaller = 1;
+		else if (exp_dif > 0)
+			smaller = (smaller >> exp_dif) | (get_n_bits(smaller, static_cast< uint8_t >(exp_dif)) != 0);
+
+		uint64_t mnt_sum = product_sign == ft3.sign ? larger + smaller : larger - smaller;
+		if (mnt_sum == 0)
+			return Unpacked{ 0, 0, R == Rounding::TowardNegative, Kind::Zero };
+		uint8_t mnt_sum_len = bit_length(mnt_sum);
+		if (mnt_sum_len < frame_length)
+		{
+			mnt_sum <<= frame_length - mnt_sum_len;
+			exp -= frame_length - mnt_sum_len;
+			mnt_sum_len = frame_length;
+		}
+
+		result.exp = static_cast< int16_t >(exp + mnt_sum_len - 1);
+		uint8_t zero_num = subnormal_shift< F >(result.exp);
+		uint8_t offset_len = mnt_sum_len - unit_place + zero_num;
+		uint64_t offset = get_n_bits(mnt_sum, offset_len);
+		mnt_sum >>= offset_len;
+		mnt_sum <<= zero_num;
+		result.mnt = static_cast< uint32_t >(subtract_bit(mnt_sum, unit_place));
+		round< F, R >(result, offset, offset_len, zero_num);
+		return result;
+	}
+
+	template< typename F, Rounding R >
+	constexpr typename F::Bits add(typename F::Bits a, typename F::Bits b)
+	{
+		return pack< F >(add< F, R >(unpack< F >(a), unpack< F >(b)));
+	}
+
+	template< typename F, Rounding R >
+	constexpr typename F::Bits sub(typename F::Bits a, typename F::Bits b)
+	{
+		return pack< F >(sub< F, R >(unpack< F >(a), unpack< F >(b)));
+	}
+
+	template< typename F, Rounding R >
+	constexpr typename F::Bits mul(typename F::Bits a, typename F::Bits b)
+	{
+		return pack< F >(mul< F, R >(unpack< F >(a), unpack< F >(b)));
+	}
+
+	template< typename F, Rounding R >
+	constexpr typename F::Bits div(typename F::Bits a, typename F::Bits b)
+	{
+		return pack< F >(div< F, R >(unpack< F >(a), unpack< F >(b)));
+	}
+
+	template< typename F, Rounding R >
+	constexpr typename F::Bits fma(typename F::Bits a, typename F::Bits b, typename F::Bits c)
+	{
+		return pack< F >(fma< F, R >(unpack< F >(a), unpack< F >(b), unpack< F >(c)));
+	}
+}	 // namespace softfloat
@@ -0,0 +1,160 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "softfloat.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <pthread.h>
+#define HAVE_PTHREADS 1
+#endif
+
+#define MAX_DOT_THREADS 64
+
+// Halves widen exactly: the normalized exponent keeps its meaning and the mantissa gains trailing zeros.
+static sf_float load_half(uint16_t bits, const sf_format *accumulator)
+{
+	sf_float ft = sf_unpack(bits, &sf_half_consts);
+	if (ft.ft_spec_t == SF_NUMBER)
+		ft.mnt <<= accumulator->mnt_len - sf_half_consts.mnt_len;
+	return ft;
+}
+
+static sf_float load_term(const uint16_t *a, const uint16_t *b, size_t i, const sf_dot_options *options)
+{
+	sf_float x = load_half(a[i], options->accumulator);
+	if (b == NULL)
+		return x;
+	sf_float y = load_half(b[i], options->accumulator);
+	return sf_mul(&x, &y, options->round_num, options->accumulator);
+}
+
+static sf_float zero(const sf_format *consts)
+{
+	sf_float ft = { .mnt = 0, .exp = consts->exp_min, .sign = 0, .ft_spec_t = SF_ZERO };
+	return ft;
+}
+
+static sf_float accumulate(const uint16_t *a,
+							const uint16_t *b,
+							size_t begin,
+							size_t end,
+							const sf_dot_options *options)
+{
+	sf_float sum = zero(options->accumulator);
+	for (size_t i = begin; i < end; i++)
+	{
+		if (b != NULL && options->fused)
+		{
+			sf_float x = load_half(a[i], options->accumulator), y = load_half(b[i], options->accumulator);
+			sum = sf_fma(&x, &y, &sum, options->round_num, options->accumulator);
+		}
+		else
+		{
+			sf_float term = load_term(a, b, i, options);
+			sum = sf_add(&sum, &term, options->round_num, options->accumulator);
+		}
+	}
+	return sum;
+}
+
+static sf_float pairwise(const uint16_t *a, const uint16_t *b, size_t begin, size_t end, const sf_dot_options *options)
+{
+	if (end - begin == 1)
+		return load_term(a, b, begin, options);
+	size_t middle = begin + (end - begin) / 2;
+	sf_float left = pairwise(a, b, begin, middle, options);
+	sf_float right = pairwise(a, b, middle, end, options);
+	return sf_add(&left, &right, options->round_num, options->accumulator);
+}
+
+sf_float sf_h_dot(const uint16_t *a, const uint16_t *b, size_t length, const sf_dot_options *options)
+{
+	if (length == 0)
+		return zero(options->accumulator);
+	if (options->order == SF_ORDER_PAIRWISE)
+		return pairwise(a, b, 0, length, options);
+	if (options->order != SF_ORDER_BLOCKED || options->block == 0)
+		return accumulate(a, b, 0, length, options);
+
+	sf_float sum = zero(options->accumulator);
+	for (size_t begin = 0; begin < length; begin += options->block)
+	{
+		size_t end = length - begin < options->block ? length : begin + options->block;
+		sf_float partial = accumulate(a, b, begin, end, options);
+		sum = sf_add(&sum, &partial, options->round_num, options->accumulator);
+	}
+	return sum;
+}
+
+typedef struct
+{
+	const uint16_t *a;
+	const uint16_t *b;
+	size_t b_stride;
+	size_t length;
+	size_t first_row;
+	size_t end_row;
+	uint32_t *out;
+	const sf_dot_options *options;
+} DotRows;
+
+static void dot_rows(const DotRows *task)
+{
+	for (size_t row = task->first_row; row < task->end_row; row++)
+	{
+		const uint16_t *b = task->b != NULL ? task->b + row * task->b_stride : NULL;
+		sf_float result = sf_h_dot(task->a + row * task->length, b, task->length, task->options);
+		task->out[row] = sf_pack(&result, task->options->accumulator);
+	}
+}
+
+#ifdef HAVE_PTHREADS
+static void *dot_rows_thread(void *task)
+{
+	dot_rows(task);
+	return NULL;
+}
+#endif
+
+void sf_h_dot_rows(const uint16_t *a,
+				   const uint16_t *b,
+				   size_t b_stride,
+				   size_t rows,
+				   size_t length,
+				   uint32_t *out,
+				   const sf_dot_options *options,
+				   unsigned threads)
+{
+	DotRows tasks[MAX_DOT_THREADS];
+	if (threads > MAX_DOT_THREADS)
+		threads = MAX_DOT_THREADS;
+	if (threads > rows)
+		threads = (unsigned)rows;
+	if (threads == 0)
+		threads = 1;
+#ifndef HAVE_PTHREADS
+	threads = 1;
+#endif
+
+	for (unsigned t = 0; t < threads; t++)
+	{
+		DotRows task = { a, b, b_stride, length, rows * t / threads, rows * (t + 1) / threads, out, options };
+		tasks[t] = task;
+	}
+#ifdef HAVE_PTHREADS
+	// Rows are independent, so each thread takes a contiguous range; a thread that fails to start runs inline.
+	pthread_t handles[MAX_DOT_THREADS];
+	int started[MAX_DOT_THREADS] = { 0 };
+	for (unsigned t = 1; t < threads; t++)
+		started[t] = pthread_create(&handles[t], NULL, dot_rows_thread, &tasks[t]) == 0;
+	dot_rows(&tasks[0]);
+	for (unsigned t = 1; t < threads; t++)
+	{
+		if (started[t])
+			pthread_join(handles[t], NULL);
+		else
+			dot_rows(&tasks[t]);
+	}
+#else
+	dot_rows(&tasks[0]);
+#endif
+}
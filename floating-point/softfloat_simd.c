@@ -0,0 +1,210 @@
+#include "softfloat.h"
+
+#include <string.h>
+
+#if defined(__GNUC__) || defined(__clang__)
+
+// Halves are widened to 32-bit lanes, one native vector register per step.
+#if defined(__AVX512F__)
+#define LANES 16
+#elif defined(__AVX2__)
+#define LANES 8
+#else
+#define LANES 4
+#endif
+
+typedef uint16_t lanes_u16 __attribute__((vector_size(LANES * 2)));
+typedef uint32_t lanes_u32 __attribute__((vector_size(LANES * 4)));
+typedef int32_t lanes_i32 __attribute__((vector_size(LANES * 4)));
+typedef float lanes_f32 __attribute__((vector_size(LANES * 4)));
+
+#define MASK(condition) ((lanes_u32)(condition))
+
+static inline lanes_u32 select_u32(lanes_u32 mask, lanes_u32 a, lanes_u32 b)
+{
+	return (mask & a) | (~mask & b);
+}
+
+static inline lanes_i32 max_i32(lanes_i32 a, lanes_i32 b)
+{
+	return (lanes_i32)select_u32(MASK(a > b), (lanes_u32)a, (lanes_u32)b);
+}
+
+static inline lanes_i32 min_i32(lanes_i32 a, lanes_i32 b)
+{
+	return (lanes_i32)select_u32(MASK(a < b), (lanes_u32)a, (lanes_u32)b);
+}
+
+// Lanes must be non-zero and below 2^31.
+static inline lanes_i32 bit_length(lanes_u32 x)
+{
+	lanes_f32 converted = __builtin_convertvector((lanes_i32)x, lanes_f32);
+	lanes_i32 length;
+	memcpy(&length, &converted, sizeof(length));
+	length = (length >> 23) - 126;
+	// The conversion may round up to the next power of two.
+	return length + (lanes_i32)(MASK((x >> (lanes_u32)(length - 1)) == 0) & MASK(length > 1));
+}
+
+// Rounds sign * significand * 2^scale (significand > 0) to the half format and packs it.
+static inline lanes_u32 round_pack(lanes_u32 sign, lanes_u32 significand, lanes_i32 scale, sf_rounding round_num)
+{
+	const lanes_u32 one = (lanes_u32){ 0 } + 1;
+	lanes_i32 length = bit_length(significand);
+	lanes_i32 shift = min_i32(max_i32(length - 11, -24 - scale), (lanes_i32){ 0 } + 31);
+	lanes_u32 right = (lanes_u32)max_i32(shift, (lanes_i32){ 0 });
+	lanes_u32 left = (lanes_u32)max_i32(-shift, (lanes_i32){ 0 });
+	lanes_u32 kept = (significand >> right) << left;
+	lanes_u32 below = significand & ((one << right) - 1);
+	lanes_u32 half = ((one << right) >> 1) | (MASK(right == 0) & one);
+
+	lanes_u32 increment;
+	switch (round_num)
+	{
+	case SF_ROUND_NEAREST_EVEN:
+		increment = MASK(below > half) | (MASK(below == half) & MASK((kept & one) != 0));
+		break;
+	case SF_ROUND_TOWARD_POSITIVE:
+		increment = MASK(below != 0) & MASK(sign == 0);
+		break;
+	case SF_ROUND_TOWARD_NEGATIVE:
+		increment = MASK(below != 0) & MASK(sign != 0);
+		break;
+	default:
+		increment = (lanes_u32){ 0 };
+		break;
+	}
+	kept += increment & one;
+
+	// The leading bit of a normal significand carries into the exponent field, including a rounding carry.
+	lanes_i32 exponent = max_i32(length + scale + 14, (lanes_i32){ 0 } + 1) - 1;
+	lanes_u32 bits = ((lanes_u32)exponent << 10) + kept;
+	lanes_u32 to_infinity;
+	if (round_num == SF_ROUND_NEAREST_EVEN)
+		to_infinity = ~(lanes_u32){ 0 };
+	else if (round_num == SF_ROUND_TOWARD_POSITIVE)
+		to_infinity = MASK(sign == 0);
+	else if (round_num == SF_ROUND_TOWARD_NEGATIVE)
+		to_infinity = MASK(sign != 0);
+	else
+		to_infinity = (lanes_u32){ 0 };
+	lanes_u32 overflow = select_u32(to_infinity, (lanes_u32){ 0 } + 0x7c00, (lanes_u32){ 0 } + 0x7bff);
+	bits = select_u32(MASK(bits >= 0x7c00), overflow, bits);
+	return bits | sign << 15;
+}
+
+static inline lanes_u32 add_lanes(lanes_u32 a, lanes_u32 b, sf_rounding round_num)
+{
+	const lanes_u32 one = (lanes_u32){ 0 } + 1;
+	lanes_u32 swap = MASK((b & 0x7fff) > (a & 0x7fff));
+	lanes_u32 x = select_u32(swap, b, a), y = select_u32(swap, a, b);
+	lanes_u32 exp_x = (x >> 10) & 0x1f, exp_y = (y >> 10) & 0x1f;
+	lanes_u32 mnt_x = x & 0x3ff, mnt_y = y & 0x3ff;
+	lanes_u32 nan = MASK(exp_x == 0x1f) & (MASK(mnt_x != 0) | (MASK(exp_y == 0x1f) & MASK(((x ^ y) & 0x8000) != 0)));
+	nan |= MASK(exp_y == 0x1f) & MASK(mnt_y != 0);
+	lanes_u32 same_sign = MASK(((x ^ y) & 0x8000) == 0);
+
+	// Three extra low bits (guard, round, sticky) are enough to round the aligned sum correctly.
+	lanes_u32 eff_x = exp_x + (MASK(exp_x == 0) & one), eff_y = exp_y + (MASK(exp_y == 0) & one);
+	lanes_u32 sig_x = (mnt_x | (MASK(exp_x != 0) & 0x400)) << 3, sig_y = (mnt_y | (MASK(exp_y != 0) & 0x400)) << 3;
+	lanes_u32 distance = (lanes_u32)min_i32((lanes_i32)(eff_x - eff_y), (lanes_i32){ 0 } + 31);
+	lanes_u32 aligned = (sig_y >> distance) | (MASK((sig_y & ((one << distance) - 1)) != 0) & one);
+	lanes_u32 sum = select_u32(same_sign, sig_x + aligned, sig_x - aligned);
+	lanes_u32 sign = x >> 15;
+	lanes_u32 cancelled = MASK(sum == 0);
+	lanes_u32 bits = round_pack(sign, sum | (cancelled & one), (lanes_i32)eff_x - 28, round_num);
+
+	lanes_u32 signed_zero = (lanes_u32){ 0 } + (round_num == SF_ROUND_TOWARD_NEGATIVE ? 0x8000 : 0);
+	bits = select_u32(cancelled, signed_zero, bits);
+	bits = select_u32(MASK((y & 0x7fff) == 0), x, bits);
+	bits = select_u32(MASK((x & 0x7fff) == 0), select_u32(same_sign, x, signed_zero), bits);
+	bits = select_u32(MASK(exp_x == 0x1f), x, bits);
+	return select_u32(nan, (lanes_u32){ 0 } + 0x7e00, bits);
+}
+
+static inline lanes_u32 mul_lanes(lanes_u32 a, lanes_u32 b, sf_rounding round_num)
+{
+	const lanes_u32 one = (lanes_u32){ 0 } + 1;
+	lanes_u32 exp_a = (a >> 10) & 0x1f, exp_b = (b >> 10) & 0x1f;
+	lanes_u32 mnt_a = a & 0x3ff, mnt_b = b & 0x3ff;
+	lanes_u32 zero_a = MASK((a & 0x7fff) == 0), zero_b = MASK((b & 0x7fff) == 0);
+	lanes_u32 inf_a = MASK(exp_a == 0x1f) & MASK(mnt_a == 0), inf_b = MASK(exp_b == 0x1f) & MASK(mnt_b == 0);
+	lanes_u32 nan = (MASK(exp_a == 0x1f) & MASK(mnt_a != 0)) | (MASK(exp_b == 0x1f) & MASK(mnt_b != 0)) |
+					(inf_a & zero_b) | (zero_a & inf_b);
+
+	lanes_u32 sig_a = mnt_a | (MASK(exp_a != 0) & 0x400), sig_b = mnt_b | (MASK(exp_b != 0) & 0x400);
+	lanes_u32 eff_a = exp_a + (MASK(exp_a == 0) & one), eff_b = exp_b + (MASK(exp_b == 0) & one);
+	lanes_u32 product = sig_a * sig_b;
+	lanes_u32 sign = (a ^ b) >> 15;
+	lanes_u32 bits = round_pack(sign, product | (MASK(product == 0) & one), (lanes_i32)(eff_a + eff_b) - 50, round_num);
+
+	bits = select_u32(zero_a | zero_b, sign << 15, bits);
+	bits = select_u32(inf_a | inf_b, (sign << 15) | 0x7c00, bits);
+	return select_u32(nan, (lanes_u32){ 0 } + 0x7e00, bits);
+}
+
+static inline void map_lanes(const uint16_t *a,
+							 const uint16_t *b,
+							 uint16_t *out,
+							 size_t count,
+							 sf_rounding round_num,
+							 lanes_u32 (*operation)(lanes_u32, lanes_u32, sf_rounding))
+{
+	for (size_t i = 0; i < count; i += LANES)
+	{
+		size_t length = count - i < LANES ? count - i : LANES;
+		lanes_u16 packed_a = { 0 }, packed_b = { 0 };
+		memcpy(&packed_a, a + i, length * sizeof(uint16_t));
+		memcpy(&packed_b, b + i, length * sizeof(uint16_t));
+		lanes_u32 result = operation(__builtin_convertvector(packed_a, lanes_u32),
+									 __builtin_convertvector(packed_b, lanes_u32),
+									 round_num);
+		lanes_u16 packed = __builtin_convertvector(result, lanes_u16);
+		memcpy(out + i, &packed, length * sizeof(uint16_t));
+	}
+}
+
+static inline lanes_u32 sub_lanes(lanes_u32 a, lanes_u32 b, sf_rounding round_num)
+{
+	return add_lanes(a, b ^ 0x8000, round_num);
+}
+
+// The rounding mode is a compile-time constant inside each case, so every mode gets its own branch-free loop.
+#define SF_ARRAY_OPERATION(name, lanes_operation)                                                                      \
+	void name(const uint16_t *a, const uint16_t *b, uint16_t *out, size_t count, sf_rounding round_num)                \
+	{                                                                                                                  \
+		switch (round_num)                                                                                             \
+		{                                                                                                              \
+		case SF_ROUND_NEAREST_EVEN:                                                                                    \
+			map_lanes(a, b, out, count, SF_ROUND_NEAREST_EVEN, lanes_operation);                                       \
+			break;                                                                                                     \
+		case SF_ROUND_TOWARD_POSITIVE:                                                                                 \
+			map_lanes(a, b, out, count, SF_ROUND_TOWARD_POSITIVE, lanes_operation);                                    \
+			break;                                                                                                     \
+		case SF_ROUND_TOWARD_NEGATIVE:                                                                                 \
+			map_lanes(a, b, out, count, SF_ROUND_TOWARD_NEGATIVE, lanes_operation);                                    \
+			break;                                                                                                     \
+		default:                                                                                                       \
+			map_lanes(a, b, out, count, SF_ROUND_TOWARD_ZERO, lanes_operation);                                        \
+			break;                                                                                                     \
+		}                                                                                                              \
+	}
+
+#else
+
+#define SF_ARRAY_OPERATION(name, operation)                                                                            \
+	void name(const uint16_t *a, const uint16_t *b, uint16_t *out, size_t count, sf_rounding round_num)                \
+	{                                                                                                                  \
+		for (size_t i = 0; i < count; i++)                                                                             \
+			out[i] = operation(a[i], b[i], round_num);                                                                 \
+	}
+
+#define add_lanes sf_h_add
+#define sub_lanes sf_h_sub
+#define mul_lanes sf_h_mul
+
+#endif
+
+SF_ARRAY_OPERATION(sf_h_add_array, add_lanes)
+SF_ARRAY_OPERATION(sf_h_sub_array, sub_lanes)
+SF_ARRAY_OPERATION(sf_h_mul_array, mul_lanes)
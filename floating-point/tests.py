@@ -49,6 +49,17 @@ def test_half_mul():
 	tester.add_easy(input = ["h", "3", "0x4145", "*", "0x42eb"], expected = "0x1.238p+3", name = "float (half): multiply (toward neg infinity)", categories = ["3", "half_multiply"])
 	return tester
 
+def test_fma():
+	tester = CmdTester("Fused multiply-add with a single rounding.", program_name)
+	tester.add_easy(input = ["h", "1", "0x3c00", "*", "0x4000", "+", "0x4200"        ], expected = "0x1.400p+2",      name = "float (half): fma (toward nearest even)",          categories = ["1", "fma"])
+	tester.add_easy(input = ["h", "1", "0x3c01", "*", "0x3c01", "-", "0x3c02"        ], expected = "0x1.000p-20",     name = "float (half): fma single rounding",                categories = ["1", "fma"])
+	tester.add_easy(input = ["f", "1", "0x3f800001", "*", "0x3f800001", "-", "0x3f800002"], expected = "0x1.000000p-46", name = "float (single): fma single rounding",         categories = ["1", "fma"])
+	tester.add_easy(input = ["f", "0", "0x7f7fffff", "*", "0x40000000", "-", "0x7f7fffff"], expected = "0x1.fffffep+127", name = "float (single): fma without overflow",       categories = ["0", "fma"])
+	tester.add_easy(input = ["h", "3", "0x3c00", "*", "0x3c00", "-", "0x3c00"        ], expected = "-0x0.000p+0",     name = "float (half): fma x - x (toward neg infinity)",    categories = ["3", "fma"])
+	tester.add_easy(input = ["h", "2", "0x0001", "*", "0x0001", "+", "0x8001"        ], expected = "-0x0.000p+0",     name = "float (half): fma underflow (toward pos infinity)", categories = ["2", "fma"])
+	tester.add_easy(input = ["f", "1", "0x7f800000", "*", "0x0", "+", "0x3f800000"   ], expected = "nan",             name = "float (single): fma inf * 0 (toward nearest even)", categories = ["1", "fma"])
+	return tester
+
 def test_special_cases():
 	tester = CmdTester("Float (half and single precisions) special cases.", program_name)
 	tester.add_easy(input = ["h", "0", "0x8000", "+", "0x0"            ], expected = "0x0.000p+0",    name = "float (half): -0 + 0 (toward zero)",         categories = ["0", "special"])
@@ -59,8 +70,15 @@ def test_special_cases():
 	tester.add_easy(input = ["f", "0", "0x7fc00000"                    ], expected = "nan",           name = "float (single): not-a-number (toward zero)", categories = ["0", "special"])
 	tester.add_easy(input = ["f", "0", "0x1", "/", "0x0"               ], expected = "inf",           name = "float (single): 1 / 0 (toward zero)",        categories = ["0", "special"])
 	tester.add_easy(input = ["f", "0", "0xff800000", "/", "0x7f800000" ], expected = "nan",           name = "float (single): not-a-number (toward zero)", categories = ["0", "special"])
+	tester.add_easy(input = ["h", "0", "0x7bff", "+", "0x5000"         ], expected = "0x1.ffcp+15",      name = "float (half): overflow (toward zero)",             categories = ["0", "special"])
+	tester.add_easy(input = ["f", "0", "0x7f7fffff", "*", "0x40000000" ], expected = "0x1.fffffep+127", name = "float (single): overflow (toward zero)",           categories = ["0", "special"])
+	tester.add_easy(input = ["h", "1", "0x0100", "*", "0x1801"         ], expected = "0x1.000p-24",      name = "float (half): underflow (toward nearest even)",    categories = ["1", "special"])
+	tester.add_easy(input = ["h", "1", "0x0003", "*", "0x3800"         ], expected = "0x1.000p-23",      name = "float (half): denormal tie (toward nearest even)", categories = ["1", "special"])
+	tester.add_easy(input = ["h", "2", "0x0001", "*", "0x0001"         ], expected = "0x1.000p-24",      name = "float (half): underflow (toward pos infinity)",    categories = ["2", "special"])
+	tester.add_easy(input = ["h", "3", "0x0100", "-", "0x0100"         ], expected = "-0x0.000p+0",      name = "float (half): x - x (toward neg infinity)",        categories = ["3", "special"])
 	return tester
 
+ERROR_CANNOT_OPEN_FILE = 1
 ERROR_ARGUMENTS_INVALID = 4
 
 def test_failing_cases():
@@ -69,6 +87,11 @@ def test_failing_cases():
 	tester.add_fail(["x", "0",  "0x0"            ], expected_exitcode = ERROR_ARGUMENTS_INVALID, name = "incorrect format")
 	tester.add_fail(["f", "13", "0x0"            ], expected_exitcode = ERROR_ARGUMENTS_INVALID, name = "incorrect rounding")
 	tester.add_fail(["f", "0",  "0x0", "_", "0x0"], expected_exitcode = ERROR_ARGUMENTS_INVALID, name = "invalid operation")
+	tester.add_fail(["h", "1", "0x0", "/", "0x0", "+", "0x0"], expected_exitcode = ERROR_ARGUMENTS_INVALID, name = "invalid fused operation")
+	tester.add_fail(["binary", "missing.bin"     ], expected_exitcode = ERROR_ARGUMENTS_INVALID, name = "binary mode without output")
+	tester.add_fail(["binary", "missing.bin", "out.bin"], expected_exitcode = ERROR_CANNOT_OPEN_FILE, name = "binary mode missing input")
+	tester.add_fail(["dot", "missing.bin"        ], expected_exitcode = ERROR_ARGUMENTS_INVALID, name = "dot mode without output")
+	tester.add_fail(["dot", "missing.bin", "out.bin"], expected_exitcode = ERROR_CANNOT_OPEN_FILE, name = "dot mode missing input")
 	return tester
 
 # Flags.
@@ -79,6 +102,7 @@ all_testers = [
     test_single_mul(),
     test_single_sum(),
     test_half_mul(),
+    test_fma(),
     test_special_cases(),
     test_failing_cases()
 ]